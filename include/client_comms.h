@@ -12,6 +12,13 @@
 #include <string>
 #include <optional>
 #include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <span>
+#include <memory_resource>
+#include <atomic>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -19,9 +26,51 @@
 #include <unistd.h>
 #include <netdb.h> // getaddrinfo
 #include <sys/time.h> // timeval struct
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <fcntl.h> // O_NONBLOCK
+#include <poll.h>
+#include <sched.h> // sched_setaffinity()
+#include <sys/mman.h> // mlockall()
+#include <sys/resource.h> // setpriority()
+#include <sys/ioctl.h>
+#include <linux/sockios.h> // SIOCOUTQ
+#include <netinet/tcp.h> // TCP_INFO
+#include <linux/net_tstamp.h> // SOF_TIMESTAMPING_*
+#include <linux/errqueue.h> // scm_timestamping
+
+#include "tools.h"
+#include "uring.h"
+#include "line_reader.h"
+#include "resolver_cache.h"
+#include "pcap_file.h"
+#include "flight_recorder.h"
 
 #define BUFFER_SIZE 65536 // 64kb is 2^16 + 4
-#define TCP_TIMEOUT 5000 // 5 second timeout
+#define TCP_TIMEOUT 5000 // 5 second timeout, also limits one connect attempt
+#define CONNECT_STAGGER 250 // ms before racing the next address
+#define KEEPALIVE_PROBES 3  // -K, unanswered keepalive probes before the connection is dropped
+#define KEEPALIVE_MAX_IDLE 32767 // s, kernel limit of TCP_KEEPIDLE and TCP_KEEPINTVL
+#define UDP_BUF_AUTO (256 * 1024)   // initial UDP socket buffers when not set by -b
+#define UDP_BUF_MAX  (8 * 1024 * 1024) // auto-sized receive buffer stops growing here
+#define DROP_WARN_INTERVAL 1000 // ms, kernel drops are reported at most this often, the total on exit
+
+// busy polling (-P)
+#define BUSY_POLL_USEC 50        // SO_BUSY_POLL, kernel spins on the device queue in recv()
+#define BUSY_POLL_SPIN 200       // ms of spinning before falling back to a blocking wait
+#define BUSY_POLL_STDIN_EVERY 64 // stdin is polled once per this many spins
+#define BUSY_POLL_NICE (-10)
+
+// ancillary data of a received datagram, SO_RXQ_OVFL and a timestamp
+#define RX_CONTROL_LEN (CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(scm_timestamping)))
+
+// wait_ready() result
+#define READY_STDIN  0x1
+#define READY_SOCKET 0x2 // socket, or the descriptor passed instead of it
+#define READY_ERROR  0x4
+#define READY_DOORBELL 0x8 // -I, a producer rang the shared-memory ring
+
+extern std::atomic<bool> stop_requested; // Ctrl+C, the wait it interrupts returns 0
 
 class Client_Comms {
     public:
@@ -29,37 +78,141 @@ class Client_Comms {
         int get_socket(); // for FD_SET() in client_session
         uint16_t next_msg_id();
         Client_Comms(const std::string &hostname, bool protocol, uint16_t port, uint16_t timeout);
+        ~Client_Comms(); // closes the socket if terminate_connection() didn't
 
         void connect_set();
+        void enable_uring(); // before connect_set(), select() is used if io_uring is unavailable
+        void enable_busy_poll(int cpu); // before connect_set(), replaces select() with spinning
+        void enable_timestamps();       // before connect_set(), kernel RX and TX timestamps
+        void enable_capture(const std::string &path); // before connect_set(), pcap of the traffic
+        void enable_offline();          // capture replay, nothing is sent
+        bool is_offline() const;        // replies are never waited for
+        void enable_reconnect();        // a closed connection is reported by connection_lost() instead of exiting
+        void enable_keepalive(uint32_t seconds); // before connect_set(), TCP gives up on a dead server after about that long
+        void adopt_socket(int fd);      // before connect_set(), TCP connection of the -t auto probe
+        int race_connect();             // after resolve_ip(), connected socket or -1, not kept
+        bool connection_lost() const;
+        size_t unacked_bytes();         // sent TCP bytes the server's kernel hasn't acknowledged, before reconnect()
+        uint32_t tcp_retransmits() const; // segments retransmitted on this connection, -B backs off when it grows
+        bool reconnect();               // new TCP connection or forgotten UDP dynamic port, false if refused
+        int64_t rx_timestamp() const;   // last received buffer, CLOCK_REALTIME ns, 0 = unknown
+        int64_t tx_timestamp() const;   // last sent datagram (UDP only), 0 = unknown
+        bool uses_uring() const;
+        unsigned wait_ready(bool want_stdin, int fd, struct timeval *timeout); // nullptr = no timeout
+        unsigned wait_until(bool want_stdin, int fd, std::optional<std::chrono::steady_clock::time_point> deadline);
+        bool read_stdin(Line_Reader &reader); // false on EOF
         // TCP
+        void set_resolver_cache(uint32_t ttl); // before resolve_ip()
         void resolve_ip();
         void connect_tcp();
-        void send_tcp_message(const std::string &msg);
-        std::string receive_tcp_message();
-        void receive_tcp_chunk();
-        // 
-        std::optional<std::string> timed_tcp_reply();               // string for TCP
-        std::optional<std::vector<uint8_t>> timed_udp_reply();      // vector for UDP
+        void send_tcp_message(std::string_view msg);
+        // deadlines come from the timer wheel of the session, an incomplete message after it is an error
+        std::pmr::string receive_tcp_message(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr = Toolkit::heap());
+        void receive_tcp_chunk(std::chrono::steady_clock::time_point deadline);
+        // results are allocated from mr, e.g. the event arena of the session
+        std::optional<std::pmr::string> timed_tcp_reply(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr = Toolkit::heap());
+        std::optional<Toolkit::Bytes> timed_udp_reply(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr = Toolkit::heap());
 
         // UDP
+        void set_socket_buffer(uint32_t bytes); // before connect_set(), 0 = auto-sized
+        uint32_t get_rx_dropped() const;        // datagrams dropped by the kernel
+        int get_rcvbuf() const;
         void set_udp();
-        void send_udp_message(const std::vector<uint8_t>& pac);
-        std::vector<uint8_t> receive_udp_message();
+        void send_udp_message(std::span<const uint8_t> pac);
+        Toolkit::Bytes receive_udp_message(std::pmr::memory_resource *mr = Toolkit::heap());
 
 
         void terminate_connection(int ex_code = 0);
+        void keep_process();            // terminate_connection() throws Session_Closed instead of exiting
+        bool is_hosted() const;         // files of the session fail the same way
         std::string buffer;
     private:
         std::string host_name;
         std::string ip_address;
-        sockaddr_in udp_address;
-        sockaddr_in dynamic_address{}; // zeroed
+        std::vector<sockaddr_storage> addresses; // families interleaved, ports set
+        bool from_cache = false;
+        std::unique_ptr<Resolver_Cache> cache;
+        sockaddr_storage udp_address{};
+        sockaddr_storage dynamic_address{}; // zeroed
         bool has_dyn_addr = false;
+        uint32_t sock_buf = 0;   // -b, 0 = auto
+        int rcvbuf = 0;          // as reported by the kernel
+        uint32_t rx_dropped = 0; // SO_RXQ_OVFL counter of the socket
+        uint32_t rx_dropped_warned = 0; // counter at the last warning
+        std::chrono::steady_clock::time_point drop_warned_at;
 
         bool tproto;
         uint16_t port;
         uint16_t udp_timeout;
         uint16_t msg_id_cnt = 0;
-        void send_udp_packet(const std::vector<uint8_t>& pac);
-        std::vector<uint8_t> receive_udp_packet();
+        void send_udp_packet(std::span<const uint8_t> pac);
+        Toolkit::Bytes receive_udp_packet(std::pmr::memory_resource *mr);
+        void store_dyn_addr(const uint8_t *pac, const sockaddr_storage &src_addr);
+        void resolve_dns();
+        unsigned select_ready(bool want_stdin, int fd, struct timeval *timeout);
+        unsigned spin_ready(bool want_stdin, int fd, struct timeval *timeout);
+        bool fd_readable(int fd);
+        void busy_poll_setup();
+        void set_buffer_size(int opt, int force_opt, int bytes);
+        void read_cmsgs(msghdr &msg);   // SO_RXQ_OVFL grows the auto-sized buffer, timestamps
+        void timestamps_setup();
+        void read_tx_timestamps();      // drains the error queue
+        void capture_setup();
+        void record_frame(bool outbound, const sockaddr_storage &peer, const void *data, size_t len); // flight recorder, capture
+        int adopted = -1;   // used by connect_tcp() instead of racing
+        uint32_t keepalive = 0; // -K, seconds
+        void keepalive_setup();
+
+        // io_uring backend (-U)
+        enum Uring_Tag : uint64_t { TAG_RECV = 1, TAG_STDIN, TAG_TCP_TX, TAG_UDP_TX };
+        uint64_t generation = 0; // of the TCP socket, in user_data of its completions (reconnect)
+        struct Udp_Tx { // has to live until its completion
+            std::vector<uint8_t> data;
+            sockaddr_storage addr;
+            iovec iov;
+            msghdr msg;
+        };
+
+        bool want_uring = false;
+        bool busy_poll = false;
+        int busy_cpu = 0;
+        bool offline = false;
+        bool reconnect_mode = false;
+        bool hosted = false;      // opened by /open, the process outlives the session
+        bool lost = false;        // TCP connection closed by the server (reconnect mode)
+        size_t failed_bytes = 0;  // messages send() refused since the last reconnect
+        void connection_closed(); // exits unless in reconnect mode
+        std::string capture_path;
+        std::unique_ptr<Pcap_Writer> capture;
+        sockaddr_storage local_address{}; // for capture
+        sockaddr_storage peer_address{};  // connected TCP address
+        bool timestamps = false;
+        bool tx_timestamps = false;
+        int64_t rx_stamp = 0;
+        int64_t tx_stamp = 0;
+        std::unique_ptr<Uring> ring;
+        struct Rx_Buffer {
+            std::vector<uint8_t> data; // empty = TCP closed
+            int64_t stamp = 0;
+        };
+        std::deque<Rx_Buffer> rx_queue; // completed receives
+        msghdr rx_msg{};                           // layout for multishot recvmsg
+        std::vector<char> stdin_buf;
+        ssize_t stdin_res = 0;
+        bool stdin_armed = false;
+        bool stdin_ready = false;
+        std::string tx_pending;  // TCP messages queued while a send is in flight
+        std::string tx_inflight;
+        std::map<uint64_t, std::unique_ptr<Udp_Tx>> udp_tx;
+        uint64_t udp_tx_id = 0;
+
+        void uring_init();
+        void uring_arm_recv();
+        void uring_arm_stdin();
+        void uring_send_tcp();
+        int  uring_wait(int timeout_ms);    // 1 = completions handled, 0 = timeout, -1 = error
+        bool uring_wait_rx(std::chrono::steady_clock::time_point deadline); // false on timeout
+        void uring_complete(const io_uring_cqe &cqe);
+        void uring_recv_done(const io_uring_cqe &cqe);
+        void uring_flush();                 // queued sends have to leave before close()
 };
@@ -14,21 +14,72 @@
 #include <arpa/inet.h> // inet_ntop
 #include <limits>
 
+#include "output_writer.h"
+
+#define KEEPALIVE_MAX (std::numeric_limits<int>::max() / 1000) // -K, s, TCP_USER_TIMEOUT is an int in ms
+
 class Client_Init {
     public:
-        void set_protocol(std::string protocol); // values tcp or udp
+        void set_protocol(std::string protocol); // values tcp, udp or auto (probed by main())
+        void set_probed(std::string protocol, int socket); // result of -t auto, socket of the TCP probe or -1
         void set_hostname(std::string host); // host = server IP or hostname
         void set_port(std::string port); // Server port -- uint16 (expected value)
         void set_udp_timeout(std::string timeout); // set UDP confirmation timeout (in milliseconds) - uint16
         void set_udp_retries(std::string max_num); // set Maximum number of UDP retransmissions -- uint8
+        void set_corpus(std::string path); // file with messages to send after authentication
+        void set_pacing(std::string gap);  // pause between messages from file (in microseconds)
+        void set_rate(std::string spec);   // rate[:burst] of sent messages per second, token bucket
+        void set_keepalive(std::string seconds); // dead server detected after about that long
+        void set_threaded(bool threaded);  // UDP networking in a separate thread
+        void set_uring(bool uring);        // io_uring instead of select()
+        void set_cache_ttl(std::string ttl); // keep resolved addresses on disk (in seconds)
+        void set_sock_buffer(std::string bytes); // UDP socket buffer size, 0 = auto-sized
+        void set_busy_poll(std::string cpu);     // spin instead of select(), pinned to cpu
+        void set_latency(bool latency);          // print round-trip statistics on exit
+        void set_capture(std::string path);      // write the traffic to a pcap file
+        void set_replay(std::string path);       // feed received messages of a pcap file to the client
+        void set_flight_path(std::string path);  // flight recorder dump, without extension
+        void set_reorder_wait(std::string wait); // hold out-of-order UDP messages (in milliseconds)
+        void set_reconnect(std::string attempts); // reconnect when the server goes away, 0 = exit
+        void set_journal(std::string path);      // outgoing messages kept in a file until delivered
+        void set_history(std::string dir);       // per-channel history log, for /history
+        void set_search(bool search);            // index messages for /search
+        void set_ingest(std::string name);       // messages from a shared-memory ring
+        void set_output(std::string mode);       // text, ndjson or binary records on stdout
+        Client_Init for_session(const std::string &name, const std::string &protocol,
+                                const std::string &host, uint16_t port) const; // /open
         void print_help();
         void validate(); 
         
         std::string get_hostname() const;
         bool is_tcp() const;
+        bool is_auto() const; // -t auto, not probed yet
         uint16_t get_port() const;
         uint16_t get_timeout() const;
         uint8_t get_retries() const;
+        std::string get_corpus() const;
+        uint32_t get_pacing() const;
+        uint32_t get_rate() const;  // 0 = unlimited
+        uint32_t get_burst() const;
+        bool is_threaded() const;
+        bool use_uring() const;
+        uint32_t get_cache_ttl() const;
+        uint32_t get_sock_buffer() const;
+        bool use_busy_poll() const;
+        int get_busy_cpu() const;
+        bool print_latency() const;
+        std::string get_capture() const;
+        std::string get_replay() const;
+        std::string get_flight_path() const;
+        uint16_t get_reorder_wait() const;
+        uint16_t get_reconnect() const;
+        std::string get_journal() const;
+        std::string get_history() const;
+        bool use_search() const;
+        std::string get_ingest() const;
+        Output_Mode get_output() const;
+        int get_probed_socket() const; // -t auto picked TCP, its connection, otherwise -1
+        uint32_t get_keepalive() const; // 0 = off
 
     private:
         std::string protocol = "";
@@ -36,4 +87,26 @@ class Client_Init {
         uint16_t port = 4567;
         uint16_t timeout = 250;
         uint8_t retries = 3;
+        std::string corpus = "";
+        uint32_t pacing = 0;
+        uint32_t rate = 0;
+        uint32_t burst = 0; // rate / 10 if not given
+        bool threaded = false;
+        bool uring = false;
+        uint32_t cache_ttl = 0; // 0 = no resolver cache
+        uint32_t sock_buffer = 0;
+        int busy_cpu = -1; // -1 = no busy polling
+        bool latency = false;
+        std::string capture = "";
+        std::string replay = "";
+        std::string flight_path = "";
+        uint16_t reorder_wait = 0; // 0 = no reordering
+        uint16_t reconnect = 0;    // attempts per lost connection
+        std::string journal = "";
+        std::string history = "";
+        bool search = false;
+        std::string ingest = "";
+        Output_Mode output = Output_Mode::Text;
+        int probed_socket = -1;
+        uint32_t keepalive = 0;
 };
\ No newline at end of file
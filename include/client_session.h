@@ -8,8 +8,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <set>
+#include <deque>
+#include <unordered_map>
+#include <span>
+#include <bitset>
+#include <charconv> // std::from_chars
+#include <type_traits> // std::conditional_t
 
 #include <iostream>
 #include <sstream>
@@ -23,21 +29,54 @@
 #include <csignal>
 #include <atomic>
 #include <memory> // unique_ptr
+#include <chrono>
+#include <thread> // sleep_for()
+#include <algorithm> // std::find
 
 #include "client_init.h"
 #include "client_comms.h"
+#include "line_reader.h"
+#include "corpus.h"
+#include "net_thread.h"
+#include "transport.h"
+#include "latency_stats.h"
+#include "pcap_file.h"
+#include "flight_recorder.h"
+#include "reorder_buffer.h"
+#include "event_arena.h"
+#include "outbox_journal.h"
+#include "timer_wheel.h"
+#include "history_log.h"
+#include "search_index.h"
+#include "session_hub.h"
+#include "shm_ring.h"
+#include "token_bucket.h"
+
+#define REPLAY_BATCH 64 // messages from file sent per loop iteration without pacing
+#define REPLY_TIMEOUT TCP_TIMEOUT // stdin lines wait at most this long for a REPLY
+#define RECONNECT_BACKOFF_MIN 50   // ms after the first failed attempt, doubles
+#define RECONNECT_BACKOFF_MAX 2000 // ms
+#define RESEND_KEEP 1024           // last TCP messages kept for resending after a lost connection
 
-extern std::atomic<bool> stop_requested; 
-
+/**
+ * @brief Chat session over a transport policy from transport.h
+ * (Tcp_Transport or Udp_Transport), instantiated in client_session.cpp.
+ */
+template <typename Transport>
 class Client_Session {
     public:
         Client_Session(const Client_Init &config);
         void run();
 
     private:
-        static Client_Session* active_instance;
+        friend class Session_Hub; // drives the sessions opened by /open
+        using Packet = typename Transport::Packet;
+        using Args = std::span<const std::string_view>; // command arguments, views into the line
+
         const Client_Init &config;
         std::unique_ptr<Client_Comms> comms; // Create instance of Client_Comms to use
+        std::unique_ptr<Net_Thread> net;     // -T, owns the UDP socket while running
+        Line_Reader stdin_reader{STDIN_FILENO};
 
         std::string display_name;
         enum msg_param {MessageID, Username, ChannelID, Secret, DisplayName, MessageContent};
@@ -50,40 +89,163 @@ class Client_Session {
             // End
         };
         ClientState state;
-
-        struct ParsedMessage {
-            std::string type;         // e.g. REPLY OK/NOK, MSG/ERR/BYE FROM
-            std::string display_name; // Sender
-            std::string content;      // Content of the message received
-        };
+        void set_state(ClientState next); // recorded by the flight recorder
+
+        // one iteration of the event loop, run() owns the loop and stdin
+        void start();
+        std::optional<std::chrono::steady_clock::time_point> next_wake_up();
+        void receive(unsigned ready); // READY_SOCKET, due timers
+        void flush();
+        bool awaiting_reply() const;
+        bool resume_pending() const;
+        bool input_blocked() const;   // stdin lines wait
+        void handle_line(const std::string& line);
+
+        std::string tag;                 // name in front of each output line, empty for the main session
+        std::ostream& out();             // stderr with -o ndjson|binary
+        void emit(Record_Type type, std::string_view sender, std::string_view content, int32_t msg_id = -1); // line or record, MSG also recorded
+        std::string clean_sender, clean_content; // Toolkit::sanitize() of received text, reused
+        std::unique_ptr<Session_Hub> hub; // main session only, the ones opened by /open
 
         void handle_chat_msg(const std::string& line);
+        bool send_chat_msg(std::string_view line, uint64_t journal_id = 0); // no checks, false if UDP gave up
         void handle_command(const std::string& line);
 
         void print_local_help();
-        void send_auth(const std::vector<std::string>& args);
-        void send_join(const std::vector<std::string>& args);
-        void rename   (const std::vector<std::string>& args);
+        void send_auth(Args args);
+        void send_join(Args args);
+        void join_channel(std::string_view channel_id); // validated
+        void rename   (Args args);
+        void show_history(Args args);
+        void search_messages(Args args);
+        void record_message(std::string_view name, std::string_view content); // history and search index
+        void channel_joined(); // JOIN confirmed by REPLY OK
 
         static void handle_sigint(int);
         void graceful_exit(int ex_code = 0);                
 
-        void send_message(const std::string& msg);  // junction function between protocols
-        void send_message(const std::vector<uint8_t>& msg);  // junction function between protocols
-        bool send_with_retries(const std::vector<uint8_t>& msg,uint16_t msg_id); // used for udp retries
-        bool check_message_content(const std::string &content, msg_param param);
-        void handle_tcp_response(std::string &msg);
-        std::optional<ParsedMessage> parse_tcp_message(const std::string &msg);
-
-        void handle_udp_response(const std::vector<uint8_t>& pac); // junction for functions bellow
-        void handle_udp_confirm (const std::vector<uint8_t>& pac);
-        void handle_udp_reply   (const std::vector<uint8_t>& pac);
-        void handle_udp_auth    (const std::vector<uint8_t>& pac);
-        void handle_udp_join    (const std::vector<uint8_t>& pac);
-        void handle_udp_msg     (const std::vector<uint8_t>& pac);
-        void handle_udp_err     (const std::vector<uint8_t>& pac);
-        void handle_udp_bye     (const std::vector<uint8_t>& pac);
-        void handle_udp_ping    (const std::vector<uint8_t>& pac);
-
-        std::set<uint16_t> processed_ids;
+        void send_message(std::string_view msg);           // junction function between protocols
+        void send_message(std::span<const uint8_t> msg);   // junction function between protocols
+        bool deliver(const Packet& msg, uint16_t msg_id);                       // send, retry if the transport needs it
+        bool confirmed_by_server() const; // the last deliver() ended with its CONFIRM
+        int  event_fd();           // socket, or eventfd of the network thread
+        bool check_message_content(std::string_view content, msg_param param);
+        Event_Arena arena; // transient allocations of one loop iteration
+
+        // members of one transport only, explicit instantiation skips them for the other,
+        // calls are behind if constexpr
+        void handle_tcp_response(std::string_view msg) requires (Transport::is_tcp);
+        void check_retransmits() requires (Transport::is_tcp);
+
+        bool send_with_retries(std::span<const uint8_t> msg, uint16_t msg_id) requires (Transport::needs_confirm); // used for udp retries
+        void confirm(uint16_t msg_id) requires (Transport::needs_confirm);
+        void handle_net_events() requires (Transport::needs_confirm);
+        void confirmed(uint16_t msg_id) requires (Transport::needs_confirm); // by the network thread
+        std::chrono::steady_clock::time_point heard_at() const requires (Transport::needs_confirm); // with the ones the network thread kept
+        void check_liveness() requires (Transport::needs_confirm);
+        std::optional<Toolkit::Bytes> udp_reply_before(Timer_Wheel::Id timer) requires (Transport::needs_confirm); // other due timers run meanwhile
+
+        void handle_udp_response(std::span<const uint8_t> pac) requires (Transport::needs_confirm); // junction for functions bellow
+        void dispatch_udp(std::span<const uint8_t> pac) requires (Transport::needs_confirm); // by type, after dedup and reordering
+        void dispatch_reordered(std::vector<std::vector<uint8_t>>& ready) requires (Transport::needs_confirm);
+        void handle_udp_confirm (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+        void handle_udp_reply   (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+        void handle_udp_msg     (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+        void handle_udp_err     (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+        void handle_udp_bye     (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+        void handle_udp_ping    (std::span<const uint8_t> pac) requires (Transport::needs_confirm);
+
+        struct Udp_State {
+            std::bitset<65536> processed_ids; // every msg_id, no allocation per message
+            std::unique_ptr<Reorder_Buffer> reorder; // -O
+            bool suppress_confirm = false;
+            std::chrono::steady_clock::time_point last_heard; // -K, any datagram from the server
+            std::unordered_map<uint16_t, uint64_t> journal_ids; // -T and -J, msg_id -> record waiting for CONFIRM
+            std::optional<uint16_t> confirmed_id; // msg_id whose CONFIRM ended the last send_with_retries()
+        };
+        struct No_State {};
+        [[no_unique_address]] std::conditional_t<Transport::needs_confirm, Udp_State, No_State> udp;
+
+        // every deadline of the session, the loop waits until the next one
+        Timer_Wheel timers;
+        Timer_Wheel::Id reply_timer;   // stdin waits for REPLY until it fires, armed by set_state()
+        Timer_Wheel::Id reorder_timer; // -O, oldest gap
+        Timer_Wheel::Id replay_timer;  // -f, next paced message
+        Timer_Wheel::Id pace_timer;    // -B, next token while lines wait for it
+        Timer_Wheel::Id journal_timer; // -J, changes waiting for the synchronous msync()
+        Timer_Wheel::Id liveness_timer; // -K, UDP, when the server has been silent for too long
+
+        // reconnect (-A)
+        struct Restore {
+            std::string username; // last AUTH not refused by the server
+            std::string secret;
+            std::string channel;  // joined, empty = default channel
+            std::string joining;  // JOIN waiting for REPLY
+            bool rejoin = false;  // JOIN is replayed once AUTH succeeds
+        } restore;
+        struct Sent {
+            std::string content;
+            size_t bytes; // on the wire
+        };
+        struct Outgoing {
+            std::string content;
+            uint64_t journal_id; // record in the journal (-J), 0 = none yet
+        };
+        std::deque<Outgoing> outbox;    // resent once the session is back, in order
+        struct Tcp_State {
+            std::deque<Sent> sent_tail; // the last RESEND_KEEP messages
+            uint32_t retransmits = 0;   // last seen, the pacer backs off when it grows
+            std::chrono::steady_clock::time_point retransmits_checked;
+        };
+        [[no_unique_address]] std::conditional_t<Transport::is_tcp, Tcp_State, No_State> tcp;
+        bool reconnecting = false;
+        bool reconnect();               // false if disabled or every attempt failed
+        bool replay_auth();             // one attempt, after the transport reconnected
+        bool resume_session();          // JOIN, then resend, true if a request was sent
+        void connection_lost();         // TCP, reconnect or exit
+        std::unique_ptr<Outbox_Journal> journal; // -J, undelivered messages of earlier runs go to outbox
+        void open_journal();
+        std::unique_ptr<History_Log> history;    // -H, messages of the current channel
+        std::unique_ptr<Search_Index> search;    // -S, every message, indexed between events
+        std::unique_ptr<Shm_Ring> ingest;        // -I, messages posted by local processes
+        void drain_ingest();
+        std::unique_ptr<Token_Bucket> pacer;     // -B, every sent message takes a token
+
+        // -L, wall clock to compare with kernel timestamps
+        Latency_Stats rtt;
+        Latency_Stats rtt_network; // kernel TX (or send) until kernel RX of the response
+        Latency_Stats rtt_client;  // the rest, spent in the client
+        void add_latency(std::chrono::system_clock::time_point sent);
+
+        // bulk send mode (-f)
+        std::unique_ptr<Corpus> corpus;
+        std::vector<std::string_view> replay_queue; // validated lines, views into corpus
+
+        struct ReplayStats {
+            size_t next = 0;    // index into replay_queue
+            size_t sent = 0;
+            size_t invalid = 0; // rejected by check_message_content
+            size_t failed = 0;  // not confirmed by the server
+            size_t bytes = 0;
+            bool started = false;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point next_send;
+        } replay;
+
+        void load_corpus();
+        bool replay_pending() const;
+        void replay_step();
+        void print_replay_summary();
+
+        // capture replay (-C)
+        struct CaptureStats {
+            bool active = false;
+            size_t messages = 0; // inbound messages handled
+            size_t bytes = 0;
+            std::chrono::steady_clock::time_point start;
+        } capture_stats;
+
+        void replay_capture();
+        void track_outbound(std::span<const uint8_t> payload); // AUTH/JOIN change the state
+        void print_capture_summary();
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+/**
+ * @file corpus.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Read-only memory mapping of a message file for bulk sending (-f).
+ * Lines are views into the mapping, nothing is copied until the message is built.
+ */
+class Corpus {
+    public:
+        Corpus(const std::string &path);
+        ~Corpus();
+        Corpus(const Corpus&) = delete;
+        Corpus& operator=(const Corpus&) = delete;
+
+        const std::vector<std::string_view>& get_lines() const;
+        size_t get_size() const;
+
+    private:
+        const char *map = nullptr;
+        size_t map_size = 0;
+        std::vector<std::string_view> lines;
+        void split_lines();
+};
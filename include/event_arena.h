@@ -0,0 +1,54 @@
+/**
+ * @file event_arena.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <memory_resource>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#define EVENT_ARENA_SIZE 131072 // bytes, two largest messages with headroom
+
+/**
+ * @brief Calls of the global operator new in the whole process,
+ * counted by the replacement in event_arena.cpp.
+ */
+uint64_t global_allocations();
+
+/**
+ * @brief Monotonic arena for whatever one iteration of the event loop
+ * allocates (command arguments, built and received messages).
+ * Memory is taken from a fixed buffer and only returned all at once by reset(),
+ * at the start of every iteration, so nothing may outlive it.
+ * Requests over the buffer go to the global allocator.
+ */
+class Event_Arena : public std::pmr::memory_resource {
+    public:
+        Event_Arena();
+        Event_Arena(const Event_Arena&) = delete;
+        Event_Arena& operator=(const Event_Arena&) = delete;
+
+        void reset();                                  // start of an event, the first one starts counting
+        void print(std::ostream &out) const;           // -L summary
+
+    private:
+        alignas(std::max_align_t) std::byte buffer[EVENT_ARENA_SIZE];
+        std::pmr::monotonic_buffer_resource pool;
+        bool started = false;
+        size_t used = 0;          // bytes requested in this event
+        size_t peak = 0;
+        uint64_t events = 0;
+        uint64_t overflows = 0;   // events that didn't fit into the buffer
+        uint64_t dirty = 0;       // events that called the global allocator
+        uint64_t allocs_seen = 0; // global_allocations() at the last reset
+
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
@@ -0,0 +1,64 @@
+/**
+ * @file flight_recorder.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#define FLIGHT_SLOTS 256 // entries kept per ring
+#define FLIGHT_SNAP  128 // bytes of each frame kept
+
+/**
+ * @brief Always-on record of the last frames in each direction and of state
+ * changes, dumped as text when the client exits with an error, or in binary
+ * form on SIGUSR2. Recording claims a slot with one atomic increment and copies
+ * the frame into it, every slot has a sequence number (odd while being written),
+ * so a dump taken in between never mixes two frames.
+ *
+ * Binary dump: "IPKFLT01", uint32 FLIGHT_SLOTS, uint32 sizeof(Flight_Entry),
+ * then for each ring (in, out, event) all entries followed by their uint32 sequences.
+ */
+class Flight_Recorder {
+    public:
+        enum Ring : uint8_t { IN = 0, OUT = 1, EVENT = 2, RING_COUNT };
+
+        struct Flight_Entry {
+            uint64_t ts_ns;  // CLOCK_REALTIME
+            uint32_t len;    // original length
+            uint16_t msg_id; // UDP only, 0xFFFF otherwise
+            uint8_t  ring;
+            uint8_t  snap;   // bytes kept in data
+            uint8_t  data[FLIGHT_SNAP];
+        };
+
+        Flight_Recorder();
+        void set_path(const std::string &base); // dump file without extension
+
+        void record(Ring ring, const void *data, size_t len, uint16_t msg_id = 0xFFFF);
+        void event(const char *text);
+
+        void dump_text();              // on abnormal exit
+        void dump_binary();            // async-signal-safe, for SIGUSR2
+        static void handle_sigusr2(int);
+        uint32_t dump_count() const;   // binary dumps so far, interrupted waits are resumed
+
+    private:
+        struct Ring_Buffer {
+            std::atomic<uint64_t> head{0};
+            std::atomic<uint32_t> seq[FLIGHT_SLOTS];
+            Flight_Entry slots[FLIGHT_SLOTS];
+        };
+        Ring_Buffer rings[RING_COUNT];
+        std::atomic<uint32_t> dumps{0};
+        char bin_path[256];  // prepared up front, no allocation in the signal handler
+        std::string text_path;
+};
+
+extern Flight_Recorder flight_recorder;
@@ -0,0 +1,69 @@
+/**
+ * @file history_log.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HISTORY_SEGMENT_DATA (64 << 20)  // bytes of lines per segment file
+#define HISTORY_SEGMENT_LINES (1 << 20)  // index entries per segment file
+#define HISTORY_DEFAULT_LINES 20         // /history without a count
+#define HISTORY_DEFAULT_CHANNEL "default" // before the first successful JOIN
+
+/**
+ * @brief Append-only chat history per channel, in memory-mapped segment files (-H).
+ * A segment is one sparse file <dir>/<channel>.<number>.hist: a header, an index
+ * of line offsets and the lines themselves as shown on stdout. Appending is a copy
+ * into the mapping, a full segment is followed by a new one. Lines are read back
+ * with write() straight from the mappings, older segments are mapped only for that.
+ */
+class History_Log {
+    public:
+        History_Log(const std::string &dir, bool hosted = false); // hosted: Session_Closed instead of exit()
+        ~History_Log();
+        History_Log(const History_Log&) = delete;
+        History_Log& operator=(const History_Log&) = delete;
+
+        void open_channel(std::string_view channel); // appends go to its newest segment
+        void append(std::string_view name, std::string_view content); // "name: content"
+        void print_last(size_t count, int fd);       // last count lines of the channel
+
+    private:
+        struct Segment_Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t lines;  // published after the line is written
+            uint32_t bytes;
+        };
+        struct Segment {
+            char *map = nullptr;
+            Segment_Header *header = nullptr;
+            uint32_t *index = nullptr; // offset of each line in data
+            char *data = nullptr;
+        };
+        static constexpr size_t INDEX_OFFSET = 64;
+        static constexpr size_t DATA_OFFSET = INDEX_OFFSET + HISTORY_SEGMENT_LINES * sizeof(uint32_t);
+        static constexpr size_t SEGMENT_SIZE = DATA_OFFSET + HISTORY_SEGMENT_DATA;
+
+        std::string dir;
+        bool hosted;
+        std::string channel;
+        std::vector<uint32_t> segments; // numbers of the channel's segments, oldest first
+        Segment current;                // newest, writable
+
+        std::string segment_path(uint32_t number) const;
+        Segment map_segment(uint32_t number, bool writable);
+        void rotate();
+};
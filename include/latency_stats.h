@@ -0,0 +1,30 @@
+/**
+ * @file latency_stats.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+
+/**
+ * @brief Round-trip samples (-L), request sent until its CONFIRM (UDP)
+ * or REPLY (TCP) is received. Summary is printed when the session ends.
+ */
+#define LATENCY_RESERVE 65536 // samples reserved with -L, growing the vector would show up as allocations
+
+class Latency_Stats {
+    public:
+        void reserve(); // with -L only, sessions without it record nothing
+        void add(std::chrono::nanoseconds sample);
+        bool empty() const;
+        void print(std::ostream &out, const std::string &name) const; // min/avg/p50/p99/max in us
+
+    private:
+        std::vector<int64_t> samples; // ns
+};
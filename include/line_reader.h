@@ -0,0 +1,40 @@
+/**
+ * @file line_reader.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cerrno>
+
+#include <unistd.h> // read()
+
+#define STDIN_CHUNK 65536 // one read() per select() wakeup
+#define STDIN_MAX_BUFFERED (STDIN_CHUNK * 16) // unprocessed bytes before stdin is no longer read
+
+/**
+ * @brief Frames lines from a raw file descriptor.
+ * Replaces std::getline(std::cin) under select(): iostreams keep already read
+ * lines hidden in their own buffer, while select() only sees the descriptor.
+ */
+class Line_Reader {
+    public:
+        Line_Reader(int fd);
+        bool fill();                         // single read(), false on EOF or error
+        bool feed(const char *buf, ssize_t bytes_rx); // data read elsewhere, -errno on error
+        bool next_line(std::string &line);   // false if no complete line is buffered
+        bool pending() const;                // unprocessed data is buffered
+        bool has_line() const;               // next_line() would return a line
+        bool full() const;                   // don't read until lines are taken
+
+    private:
+        int fd;
+        bool at_eof = false;
+        std::vector<char> data;
+        size_t head = 0; // start of unprocessed data
+        void compact();
+};
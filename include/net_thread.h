@@ -0,0 +1,96 @@
+/**
+ * @file net_thread.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <sys/eventfd.h>
+#include <sys/select.h>
+#include <csignal>
+
+#include "client_comms.h"
+#include "spsc_queue.h"
+
+#define NET_QUEUE_SIZE 1024 // slots in each direction
+
+struct Net_Request {
+    std::vector<uint8_t> data; // complete UDP message
+    bool confirm = true;       // wait for CONFIRM and retransmit
+};
+
+struct Net_Event {
+    enum class Type { Packet, Retried, Confirmed, GaveUp } type = Type::Packet;
+    uint16_t msg_id = 0;
+    Toolkit::Bytes data;       // Packet only
+};
+
+/**
+ * @brief UDP network thread (-T).
+ * Owns the socket of Client_Comms while running: sends CONFIRMs, answers PINGs,
+ * drops duplicates and retransmits unconfirmed messages. Everything else is
+ * passed to the session thread through Spsc_Queue, readiness is signalled by eventfd.
+ */
+class Net_Thread {
+    public:
+        Net_Thread(Client_Comms &comms, uint16_t timeout, uint8_t retries);
+        ~Net_Thread();
+        Net_Thread(const Net_Thread&) = delete;
+        Net_Thread& operator=(const Net_Thread&) = delete;
+
+        void start();
+        void stop(bool drain = false); // joins, socket is owned by the caller again
+        bool running() const;
+
+        // session thread side
+        void send(std::vector<uint8_t> &&pac, bool confirm = true); // waits while the queue is full
+        bool next_event(Net_Event &ev); // after stop() also the events the queue had no room for
+        int get_event_fd() const;
+        void clear_event_fd();
+        std::chrono::steady_clock::time_point last_heard() const; // any datagram, PINGs are not passed on
+
+    private:
+        Client_Comms &comms;
+        uint16_t udp_timeout;
+        uint8_t retries;
+
+        Spsc_Queue<Net_Request, NET_QUEUE_SIZE> outbound; // session -> network
+        Spsc_Queue<Net_Event, NET_QUEUE_SIZE> inbound;    // network -> session
+        int ui_efd = -1;  // session waits on this
+        int net_efd = -1; // network thread waits on this
+
+        std::thread thread;
+        std::atomic<bool> stop_requested{false};
+        std::atomic<bool> drain{false}; // deliver queued messages before stopping
+        std::atomic<std::chrono::steady_clock::rep> heard{0}; // last_heard()
+        bool started = false;
+
+        // network thread only
+        struct In_Flight {
+            Net_Request req;
+            uint16_t msg_id;
+            uint8_t tries;
+            std::chrono::steady_clock::time_point deadline;
+        };
+        std::optional<In_Flight> in_flight; // one unconfirmed message, like send_with_retries()
+        std::deque<Net_Request> waiting;
+        std::deque<Net_Event> backlog;      // inbound queue was full
+        std::set<uint16_t> processed_ids;
+
+        void loop();
+        void handle_packet(Toolkit::Bytes &&pac);
+        void check_in_flight();
+        void post(Net_Event &&ev);
+        void flush_backlog();
+        static void notify(int efd);
+};
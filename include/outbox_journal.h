@@ -0,0 +1,92 @@
+/**
+ * @file outbox_journal.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <optional>
+
+#include <sys/mman.h> // mmap(), msync()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define JOURNAL_CHUNK (1 << 20) // file grows by this many bytes
+#define JOURNAL_BATCH 64        // changes between two synchronous msync() calls at most
+#define JOURNAL_SYNC_MS 100     // a change waits at most this long for the synchronous msync()
+
+/**
+ * @brief Append-only file of outgoing messages, mapped shared (-J).
+ * A message is appended before it is sent and marked delivered once confirmed,
+ * a record survives a crash of the process as soon as it is written to the mapping,
+ * a crash of the system once sync() has flushed it synchronously, after JOURNAL_BATCH
+ * changes or JOURNAL_SYNC_MS. Messages still pending when the
+ * journal is opened are returned by recovered(), the file is rewound once
+ * nothing is pending.
+ */
+class Outbox_Journal {
+    public:
+        struct Entry {
+            uint64_t id; // offset of the record
+            std::string content;
+        };
+
+        Outbox_Journal(const std::string &path, bool hosted = false); // hosted: Session_Closed instead of exit()
+        ~Outbox_Journal();
+        Outbox_Journal(const Outbox_Journal&) = delete;
+        Outbox_Journal& operator=(const Outbox_Journal&) = delete;
+
+        uint64_t append(std::string_view content); // pending record, its id
+        void delivered(uint64_t id);
+        void sync(bool now = false);               // MS_SYNC at the batch boundary or when now, MS_ASYNC before
+        std::optional<std::chrono::steady_clock::time_point> sync_due() const; // next MS_SYNC, nullopt if clean
+        std::vector<Entry> recovered();            // pending at open, once
+        size_t pending() const;
+
+    private:
+        struct File_Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t epoch;    // records of older epochs were all delivered
+            uint32_t reserved;
+        };
+        struct Record_Header {
+            uint32_t magic;
+            uint32_t epoch;
+            uint32_t length;   // content bytes
+            uint32_t checksum; // FNV-1a of content
+            uint8_t state;
+            uint8_t pad[3];
+        };
+        enum : uint8_t { PENDING = 1, DELIVERED = 2 };
+
+        int fd = -1;
+        std::string path;
+        bool hosted;
+        char *map = nullptr;
+        size_t map_size = 0;
+        size_t end = sizeof(File_Header);  // next record
+        size_t dirty_from = SIZE_MAX;      // range not synced yet
+        size_t dirty_to = 0;
+        size_t unsynced = 0;               // changes since the last MS_SYNC
+        bool async_pending = false;        // changes since the last MS_ASYNC
+        std::chrono::steady_clock::time_point dirty_since; // first change since the last MS_SYNC
+        size_t pending_records = 0;
+        std::vector<Entry> recovered_entries;
+
+        File_Header* header();
+        Record_Header* record(uint64_t id);
+        [[noreturn]] void fail(int ex_code); // unmaps and closes first, the session may be the only one ending
+        void grow(size_t min_size);
+        void scan();
+        void mark_dirty(size_t from, size_t to);
+        static uint32_t checksum(std::string_view content);
+};
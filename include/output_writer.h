@@ -0,0 +1,50 @@
+/**
+ * @file output_writer.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <unistd.h> // write()
+
+#define OUTPUT_BUFFER 65536 // records are written once this much is buffered, and once per loop iteration
+
+enum class Output_Mode { Text, Ndjson, Binary };
+
+enum class Record_Type : uint8_t { Msg = 1, Reply_Ok, Reply_Nok, Err, Bye };
+
+/**
+ * @brief Machine-readable output of received messages (-o ndjson|binary), one record per event.
+ * Records are built in a buffer and written to stdout with one write() per OUTPUT_BUFFER,
+ * or when the event loop goes to sleep. JSON escaping scans 16 bytes at a time with SSE2,
+ * so printable text is copied without looking at each byte.
+ *
+ * Binary record, native byte order:
+ *   uint32 length of the rest, uint8 type, 3 bytes reserved, int32 msg_id (-1 = TCP),
+ *   int64 receive time (ns since epoch), uint16 session, channel and sender length,
+ *   2 bytes reserved, uint32 content length, then the four strings without terminators
+ */
+class Output_Writer {
+    public:
+        ~Output_Writer(); // exit() flushes what is left
+        void set_mode(Output_Mode mode);
+        Output_Mode get_mode() const;
+        void record(Record_Type type, std::string_view session, std::string_view channel,
+                    std::string_view sender, std::string_view content, int32_t msg_id, int64_t stamp_ns);
+        void flush();
+
+    private:
+        Output_Mode mode = Output_Mode::Text;
+        std::string buffer;
+
+        void append_json(std::string_view key, std::string_view value);
+        void append_escaped(std::string_view value);
+};
+
+extern Output_Writer output_writer;
@@ -0,0 +1,82 @@
+/**
+ * @file pcap_file.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define PCAP_MAGIC_NS 0xa1b23c4d // nanosecond timestamps
+#define PCAP_MAGIC_US 0xa1b2c3d4
+#define PCAP_SNAPLEN  262144
+
+// link types of the captures which can be replayed
+#define LINKTYPE_NULL      0   // BSD loopback
+#define LINKTYPE_ETHERNET  1
+#define LINKTYPE_RAW       101 // written by Pcap_Writer
+#define LINKTYPE_LINUX_SLL 113 // tcpdump -i any
+
+/**
+ * @brief Capture of the traffic of one connection (-c) in the classic pcap format,
+ * readable by Wireshark/tcpdump. IP and TCP/UDP headers are synthesized around
+ * the payloads, TCP segments get consecutive sequence numbers.
+ */
+class Pcap_Writer {
+    public:
+        Pcap_Writer(const std::string &path, bool tcp, bool hosted = false); // hosted: Session_Closed instead of exit()
+        ~Pcap_Writer();
+        Pcap_Writer(const Pcap_Writer&) = delete;
+        Pcap_Writer& operator=(const Pcap_Writer&) = delete;
+
+        void write(bool outbound, const sockaddr_storage &local, const sockaddr_storage &peer,
+                   const uint8_t *data, size_t len);
+
+    private:
+        FILE *file = nullptr;
+        bool tcp;
+        uint32_t seq_out = 1;
+        uint32_t seq_in = 1;
+        uint16_t ip_id = 0;
+};
+
+/**
+ * @brief One payload of a capture, inbound ones are sent to the client.
+ */
+struct Pcap_Frame {
+    bool inbound;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * @brief Reads payloads of TCP or UDP packets from a pcap file (replay, -C).
+ * The client is whoever sent the first payload, TCP retransmissions are dropped.
+ */
+class Pcap_Reader {
+    public:
+        Pcap_Reader(const std::string &path, bool tcp);
+        const std::vector<Pcap_Frame>& get_frames() const;
+
+    private:
+        bool tcp;
+        std::vector<Pcap_Frame> frames;
+
+        // client endpoint, set by the first payload
+        bool have_client = false;
+        std::vector<uint8_t> client_ip;
+        uint16_t client_port = 0;
+        bool have_seq_in = false;
+        uint32_t next_seq_in = 0;
+
+        void parse_ip(const uint8_t *pkt, size_t len);
+        void add_payload(const uint8_t *src_ip, const uint8_t *dst_ip, size_t ip_len,
+                         const uint8_t *l4, size_t len);
+};
@@ -0,0 +1,52 @@
+/**
+ * @file reorder_buffer.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <optional>
+#include <cstdint>
+
+#define REORDER_MAX_HELD 64 // messages held before a gap is given up
+
+/**
+ * @brief Releases inbound UDP messages in the order of the server's msg_id (-O).
+ * A message after a gap is held until the gap is filled, for at most max_wait
+ * or until REORDER_MAX_HELD messages are waiting, then the gap is skipped.
+ * Messages older than the next expected one are released right away.
+ */
+class Reorder_Buffer {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Packet = std::vector<uint8_t>;
+
+        Reorder_Buffer(std::chrono::milliseconds max_wait);
+
+        void push(uint16_t msg_id, std::span<const uint8_t> pac, std::vector<Packet> &ready);
+        void expire(std::vector<Packet> &ready);    // gaps older than max_wait
+        void flush(std::vector<Packet> &ready);     // everything held, in order
+        std::optional<Clock::time_point> deadline() const;
+        size_t skipped() const;                     // msg_ids given up on
+
+    private:
+        struct Held {
+            Packet pac;
+            Clock::time_point since;
+        };
+        std::chrono::milliseconds max_wait;
+        bool started = false;
+        uint32_t expected = 0;          // msg_id extended to 32 bits, no wrap-around
+        std::map<uint32_t, Held> held;  
+        size_t skipped_ids = 0;
+
+        uint32_t unwrap(uint16_t msg_id) const;
+        void release(std::vector<Packet> &ready); // consecutive messages from expected
+        void skip_gap(std::vector<Packet> &ready);
+};
@@ -0,0 +1,30 @@
+/**
+ * @file resolver_cache.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <sys/socket.h>
+
+/**
+ * @brief On-disk cache of resolved addresses (-R), so repeated starts skip DNS.
+ * One line per hostname: "<hostname> <expiry unix time> <address>...",
+ * stored in $XDG_CACHE_HOME (or ~/.cache) as ipk25chat-resolv.cache.
+ */
+class Resolver_Cache {
+    public:
+        Resolver_Cache(uint32_t ttl); // seconds
+        std::vector<sockaddr_storage> lookup(const std::string &host); // empty if missing or expired
+        void store(const std::string &host, const std::vector<sockaddr_storage> &addrs);
+
+    private:
+        std::string path;
+        uint32_t ttl;
+};
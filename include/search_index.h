@@ -0,0 +1,66 @@
+/**
+ * @file search_index.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <cstdint>
+
+#define SEARCH_BATCH 256        // messages indexed per loop iteration
+#define SEARCH_MAX_RESULTS 20   // newest matches shown by /search
+#define SEARCH_CHUNK (1 << 20)  // message store grows by this many bytes, nothing is moved
+#define SEARCH_MAX_TOKEN 64     // longer words are cut
+
+/**
+ * @brief Inverted index over sent and received messages (-S).
+ * Messages are stored right away, words are indexed later in batches by
+ * index_pending(), so indexing never delays a CONFIRM or output. Each lowercase
+ * word and each sender ("from:<name>") maps to a posting list of message numbers,
+ * delta-encoded as varints. A query is the intersection of its posting lists.
+ */
+class Search_Index {
+    public:
+        struct Result {
+            std::vector<uint32_t> newest; // at most limit, oldest first
+            size_t total = 0;
+        };
+
+        void add(std::string_view name, std::string_view content); // stored now, indexed later
+        bool index_pending(size_t max_docs);                        // true while messages wait
+        Result search(std::span<const std::string_view> query, size_t limit); // words and from:<name>, all must match
+        std::string_view name(uint32_t doc) const;
+        std::string_view content(uint32_t doc) const;
+        size_t size() const;
+
+    private:
+        struct Doc {
+            uint32_t chunk;
+            uint32_t offset;
+            uint32_t name_len;
+            uint32_t content_len; // right after the name
+        };
+        struct Postings {
+            std::vector<uint8_t> bytes; // varint gaps between message numbers
+            uint32_t last = 0;
+            uint32_t count = 0;
+            void push(uint32_t doc);
+        };
+
+        std::vector<std::string> chunks; // message store, each reserved to SEARCH_CHUNK
+        std::vector<Doc> docs;
+        uint32_t indexed = 0;            // docs from here wait for index_pending()
+        std::unordered_map<std::string, Postings> terms; // words, "\x01<name>" for senders
+
+        static std::vector<uint32_t> decode(const Postings &list);
+        static void intersect(std::vector<uint32_t> &docs, const Postings &list);
+        template <typename F>
+        static void for_each_word(std::string_view text, F &&fn);
+};
@@ -0,0 +1,86 @@
+/**
+ * @file session_hub.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <optional>
+#include <chrono>
+#include <span>
+
+#include <poll.h>
+
+#include "client_init.h"
+#include "transport.h"
+
+#define HUB_MAIN "main"    // name of the session given on the command line
+#define HUB_NAME_MAX 20    // session names are also part of file names
+
+template <typename Transport>
+class Client_Session;
+
+/**
+ * @brief Sessions opened by /open next to the main one, driven by its event loop.
+ * Each has its own settings (Client_Init::for_session()), socket and timers. The loop
+ * waits on all their descriptors with one ppoll(), until the earliest of their timers.
+ * Lines from stdin go to the session picked by /switch, output lines are tagged with
+ * the session name. A session that ends (BYE, ERR, timeout, failing file) throws
+ * Session_Closed out of Toolkit::fail() and is dropped, the process exits with the main session.
+ * wait() also serves the main session alone when it has a doorbell (-I) to wait on.
+ * A session waiting synchronously (send_with_retries(), timed_tcp_reply()) blocks all others.
+ */
+class Session_Hub {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Args = std::span<const std::string_view>;
+
+        Session_Hub(const Client_Init &config);
+        ~Session_Hub();
+        Session_Hub(const Session_Hub&) = delete;
+        Session_Hub& operator=(const Session_Hub&) = delete;
+
+        void open(Args args);      // <name> tcp|udp <host> <port>, the new session gets stdin
+        void switch_to(Args args); // [name], lists the sessions without one
+        static bool is_hub_command(std::string_view line);
+        bool empty() const;
+        bool guest_active() const; // stdin goes to an opened session, not the main one
+
+        std::optional<Clock::time_point> next_wake_up(std::optional<Clock::time_point> main);
+        unsigned wait(bool want_stdin, int main_fd, int doorbell_fd, std::optional<Clock::time_point> deadline); // READY_* of the main session
+        void receive();            // every opened session, ready or not (timers)
+        void flush();
+        bool input_blocked();
+        void handle_line(const std::string &line);
+        void close_all();          // BYE from each, before the main session exits
+
+    private:
+        static constexpr size_t MAIN = SIZE_MAX; // active session is the main one
+
+        struct Entry {
+            std::string name;
+            std::string address;                 // tcp|udp host:port, for the list
+            std::unique_ptr<Client_Init> config; // outlives the session
+            std::variant<std::unique_ptr<Client_Session<Tcp_Transport>>,
+                         std::unique_ptr<Client_Session<Udp_Transport>>> session;
+            unsigned ready = 0;  // READY_SOCKET from the last wait()
+            bool closed = false; // dropped by prune()
+        };
+
+        const Client_Init &config; // of the main session
+        std::vector<Entry> sessions;
+        size_t active = MAIN;
+        std::vector<pollfd> fds;   // reused by wait()
+
+        template <typename F>
+        void call(size_t index, F &&fn); // Session_Closed marks the session closed
+        void prune();
+        std::ostream& out() const;
+};
@@ -0,0 +1,104 @@
+/**
+ * @file shm_ring.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+
+#include <sys/mman.h> // shm_open(), mmap()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SHM_RING_SLOTS 1024 // messages waiting at once, power of two
+#define SHM_SLOT_SIZE 4096  // longer messages go through stdin
+#define SHM_BATCH 64        // messages sent per loop iteration
+#define SHM_CACHE_LINE 64
+
+enum class Shm_Status : uint32_t {
+    Pending = 0,
+    Sent,      // handed to the kernel (TCP) or to the network thread (-T)
+    Confirmed, // UDP, its CONFIRM received before the next message was sent
+    Queued,    // connection lost, resent after reconnecting (-A)
+    Invalid,   // not a valid MessageContent
+    Failed,    // not confirmed, the client exits
+    Expired    // completed more than SHM_RING_SLOTS messages ago, the status is gone
+};
+
+/**
+ * @brief Shared-memory ring for local producers (-I), the POSIX shm object /<name>.
+ * Any number of producer processes claim slots by a compare-and-swap on head, the
+ * client is the only consumer. Every slot carries a sequence number (bounded queue
+ * by D. Vyukov), so a producer never waits for another one to finish writing. The
+ * client sends the message straight from its slot and publishes the result under
+ * the same ticket in a completion array. Producers ring the doorbell only while the
+ * client waits for it. The doorbell is the FIFO /dev/shm/<name>.bell, because another
+ * process can't open an eventfd by name.
+ */
+class Shm_Ring {
+    public:
+        static std::unique_ptr<Shm_Ring> create(const std::string &name); // client, keeps messages of an earlier run
+        static std::unique_ptr<Shm_Ring> attach(const std::string &name); // producer, nullptr if there is no ring
+        ~Shm_Ring();
+        Shm_Ring(const Shm_Ring&) = delete;
+        Shm_Ring& operator=(const Shm_Ring&) = delete;
+
+        // producer side
+        std::optional<uint64_t> post(std::string_view content); // ticket, nullopt if full or too long
+        Shm_Status status(uint64_t ticket) const;
+
+        // client side
+        int doorbell_fd() const;
+        bool sleep();        // false if messages are waiting, producers ring until wake()
+        void wake(bool rung); // after waiting, rung = the doorbell was readable
+        bool peek(std::string_view &content) const; // oldest message, stays in its slot
+        void pop(Shm_Status status);                // completes the oldest message, frees its slot
+
+    private:
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t slots;
+            uint32_t slot_size;
+            alignas(SHM_CACHE_LINE) std::atomic<uint64_t> head; // next ticket, producers
+            alignas(SHM_CACHE_LINE) std::atomic<uint64_t> tail; // next message to send, client
+            alignas(SHM_CACHE_LINE) std::atomic<uint32_t> sleeping; // client waits on the doorbell
+        };
+        struct Slot {
+            std::atomic<uint64_t> seq; // ticket + 1 once written, ticket + SHM_RING_SLOTS once free again
+            uint32_t length;
+            char data[SHM_SLOT_SIZE - sizeof(std::atomic<uint64_t>) - sizeof(uint32_t)];
+        };
+        struct Completion {
+            std::atomic<uint64_t> ticket; // ticket + 1, written after status
+            uint32_t status;
+            uint32_t reserved;
+        };
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                      "atomics in shared memory have to be lock-free");
+        static_assert(sizeof(Slot) == SHM_SLOT_SIZE);
+
+        static constexpr size_t SLOTS_OFFSET = sizeof(Header);
+        static constexpr size_t COMPLETIONS_OFFSET = SLOTS_OFFSET + SHM_RING_SLOTS * sizeof(Slot);
+        static constexpr size_t MAP_SIZE = COMPLETIONS_OFFSET + SHM_RING_SLOTS * sizeof(Completion);
+
+        Shm_Ring(const std::string &name, char *map);
+        std::string bell_path;
+        char *map;
+        Header *header;
+        Slot *slots;
+        Completion *completions;
+        int bell = -1;
+        uint64_t tail = 0; // client's copy of header->tail
+
+        void ring();
+};
@@ -0,0 +1,57 @@
+/**
+ * @file spsc_queue.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+#define CACHE_LINE 64
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ * Each side keeps a cached copy of the other side's index, so the shared
+ * cache line is only touched when the queue looks full/empty.
+ */
+template <typename T, size_t N>
+class Spsc_Queue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Spsc_Queue size must be a power of two");
+
+    public:
+        // producer side, false if full
+        bool push(T &&item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail_cache == N) {
+                tail_cache = tail.load(std::memory_order_acquire);
+                if (h - tail_cache == N) return false;
+            }
+            slots[h & (N - 1)] = std::move(item);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side, false if empty
+        bool pop(T &item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head_cache) {
+                head_cache = head.load(std::memory_order_acquire);
+                if (t == head_cache) return false;
+            }
+            item = std::move(slots[t & (N - 1)]);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        alignas(CACHE_LINE) std::atomic<size_t> head{0}; // written by producer
+        size_t tail_cache = 0;
+        alignas(CACHE_LINE) std::atomic<size_t> tail{0}; // written by consumer
+        size_t head_cache = 0;
+        alignas(CACHE_LINE) std::array<T, N> slots{};
+};
@@ -0,0 +1,76 @@
+/**
+ * @file timer_wheel.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+#define WHEEL_LEVELS 6 // 64^6 ticks, about 19 hours, later timers are cascaded again
+#define WHEEL_BITS 6   // 64 slots per level
+#define WHEEL_TICK std::chrono::microseconds(1)
+
+/**
+ * @brief Hierarchical timing wheel, every protocol deadline of the session is a timer here.
+ * Level l has 64 slots of 64^l ticks each, a timer goes to the lowest level whose
+ * window still contains it and is cascaded down as the wheel turns. Schedule and
+ * cancel are O(1) on intrusive lists, advance() and next_expiry() jump straight to
+ * the next occupied slot through a bitmap per level, so idle ticks cost nothing.
+ */
+class Timer_Wheel {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Callback = std::function<void()>;
+
+        struct Id {
+            uint32_t index = UINT32_MAX;
+            uint32_t generation = 0; // stale after the timer fired or was cancelled
+        };
+
+        Timer_Wheel();
+
+        Id schedule(Clock::time_point when, Callback fn = {}); // fn may be empty, see pending()
+        bool cancel(Id id);                                    // false if not pending
+        void reschedule(Id &id, Clock::time_point when, Callback fn = {});
+        bool pending(Id id) const;
+        Clock::time_point expiry(Id id) const;                 // of a pending timer
+        std::optional<Clock::time_point> next_expiry() const;
+        size_t advance(Clock::time_point now);                 // runs expired callbacks, returns their count
+        size_t size() const;
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr uint64_t SLOTS = 1 << WHEEL_BITS;
+
+        struct Node {
+            uint64_t tick = 0;    // expiry
+            uint32_t prev = NIL;
+            uint32_t next = NIL;  // also the free list
+            uint32_t generation = 0;
+            uint8_t level = 0;
+            uint8_t slot = 0;
+            bool armed = false;
+            Callback fn;
+        };
+        Clock::time_point origin;
+        uint64_t base = 0;        // next tick to process
+        std::vector<Node> nodes;
+        uint32_t free_head = NIL;
+        size_t armed_count = 0;
+        uint32_t heads[WHEEL_LEVELS][SLOTS];
+        uint64_t occupied[WHEEL_LEVELS] = {}; // bit per non-empty slot
+
+        uint64_t to_tick(Clock::time_point when) const; // rounded up, never early
+        void place(uint32_t index);
+        void unlink(uint32_t index);
+        uint32_t first_slot(int level) const;
+        uint64_t next_event() const;  // next tick where a slot fires or cascades, UINT64_MAX = none
+        void release(uint32_t index);
+};
@@ -0,0 +1,47 @@
+/**
+ * @file token_bucket.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#define PACER_FLOOR 16           // back_off() never goes below rate / PACER_FLOOR
+#define PACER_RECOVERY 0.25      // rate regained per second without losses, fraction of the set rate
+#define PACER_HOLD_MS 200        // losses closer together count as one
+
+/**
+ * @brief Outbound pacing of chat messages (-B rate[:burst]).
+ * Tokens refill at the current rate up to burst, each message takes one. A message
+ * may take the last token even if it goes below zero (resends after reconnecting),
+ * the following ones wait until the bucket is paid back. Retransmissions and drops
+ * halve the current rate (AIMD), it grows back linearly towards the set rate.
+ */
+class Token_Bucket {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        Token_Bucket(double rate, double burst);
+
+        bool ready(Clock::time_point now = Clock::now()); // a whole token is there
+        void take();
+        Clock::time_point ready_at() const;                // of the next token, after ready() returned false
+        void back_off(Clock::time_point now = Clock::now());
+        double current_rate() const;                       // messages per second
+        size_t back_offs() const;
+
+    private:
+        double rate;    // set by -B
+        double burst;
+        double current; // lowered by back_off()
+        double tokens;
+        Clock::time_point last;
+        Clock::time_point last_loss;
+        size_t losses = 0;
+
+        void refill(Clock::time_point now);
+};
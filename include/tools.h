@@ -8,11 +8,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <stdexcept> // std::stoi exceptions
-#include <regex>
 #include <vector>
+#include <memory_resource>
+#include <span>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 #define ERR_MISSING  10
 #define ERR_INVALID  11
@@ -21,6 +24,11 @@
 #define ERR_SERVER   14
 #define ERR_INTERNAL 99
 
+// thrown instead of exit() in a session opened by /open, see Toolkit::fail()
+struct Session_Closed {
+    int ex_code;
+};
+
 #ifdef DEBUG_PRINT
 #define printf_debug(format, ...) \
     do { \
@@ -41,44 +49,63 @@ class Toolkit
         // nothing so far
     public:
         static int catch_stoi(const std::string &str, int size, const std::string &flag);
-        static bool only_allowed_chars(const std::string &str, const std::string &regex);
-        static bool only_printable_chars(const std::string &str, bool allow_space_and_lf = false); // range (0x21-7E) + space and line feed (0x0A,0x20)
+        [[noreturn]] static void fail(int ex_code, bool hosted); // exit(), or Session_Closed if opened by /open
+        static bool only_allowed_chars(std::string_view str); // [a-zA-Z0-9_-]+, Username, ChannelID and Secret
+        static bool only_printable_chars(std::string_view str, bool allow_space_and_lf = false); // range (0x21-7E) + space and line feed (0x0A,0x20)
+        static size_t first_unprintable(std::string_view str, bool allow_space_and_lf = false); // str.size() if there is none
+        static std::string_view sanitize(std::string_view str, bool allow_space_and_lf, std::string &scratch); // others as \xNN, str itself if clean
         
-        static void append_uint8(std::vector<uint8_t>& buf, uint8_t value);
-        static void append_uint16(std::vector<uint8_t>& buf, uint16_t value);
-        static void append_string(std::vector<uint8_t>& buf, const std::string& s);
+        // IPv4/IPv6 addresses in sockaddr_storage
+        static bool parse_address(const std::string &ip, sockaddr_storage &addr);
+        static std::string address_to_string(const sockaddr_storage &addr); // without port
+        static socklen_t address_len(const sockaddr_storage &addr);
+        static void set_port(sockaddr_storage &addr, uint16_t port);
+        static uint16_t get_port(const sockaddr_storage &addr);
+
+        using Bytes = std::pmr::vector<uint8_t>; // builders allocate from mr, e.g. the event arena
+        static std::pmr::memory_resource *heap() { return std::pmr::get_default_resource(); }
+
+        static void append_uint8(Bytes& buf, uint8_t value);
+        static void append_uint16(Bytes& buf, uint16_t value);
+        static void append_string(Bytes& buf, std::string_view s);
+        static std::string_view read_string(std::span<const uint8_t> buf, size_t pos); // up to '\0', view into buf
         
-        static std::vector<uint8_t> build_confirm (uint16_t ref_msg_id);
+        static Bytes build_confirm (uint16_t ref_msg_id, std::pmr::memory_resource *mr = heap());
 
-        static std::vector<uint8_t> build_reply (
+        static Bytes build_reply (
             uint16_t msg_id,
             uint8_t result, // 0 or 1
             uint16_t ref_msg_id, // id of message being replied to
-            const std::string& msg_contents
+            std::string_view msg_contents,
+            std::pmr::memory_resource *mr = heap()
         );
 
-        static std::vector<uint8_t> build_auth (
+        static Bytes build_auth (
             uint16_t msg_id, 
-            const std::string& username,    
-            const std::string& display_name, 
-            const std::string& secret
+            std::string_view username,    
+            std::string_view display_name, 
+            std::string_view secret,
+            std::pmr::memory_resource *mr = heap()
         );
         
-        static std::vector<uint8_t> build_join (
+        static Bytes build_join (
             uint16_t msg_id,
-            const std::string& channel_id,
-            const std::string& display_name
+            std::string_view channel_id,
+            std::string_view display_name,
+            std::pmr::memory_resource *mr = heap()
         );
 
         // err is identical to msg, except msg_type  
         // thus is_error has been added
-        static std::vector<uint8_t> build_msg (
+        static Bytes build_msg (
             uint16_t msg_id,
-            const std::string& display_name,
-            const std::string& msg_contents,
-            bool is_error = false
+            std::string_view display_name,
+            std::string_view msg_contents,
+            bool is_error = false,
+            std::pmr::memory_resource *mr = heap()
         );
 
-        static std::vector<uint8_t> build_ping (uint16_t msg_id);
-        static std::vector<uint8_t> build_bye  (uint16_t msg_id, const std::string& display_name);
+        static Bytes build_ping (uint16_t msg_id, std::pmr::memory_resource *mr = heap());
+        static Bytes build_bye  (uint16_t msg_id, std::string_view display_name,
+                                 std::pmr::memory_resource *mr = heap());
 };
@@ -0,0 +1,101 @@
+/**
+ * @file transport.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory_resource>
+#include <initializer_list>
+#include <optional>
+#include <cstring>
+
+#include "tools.h"
+
+/**
+ * Transport policies for Client_Session<Transport>.
+ * The protocol is chosen once in main(), so the session doesn't branch on it
+ * for every message and the builders below can be inlined.
+ * A new transport has to provide the same members.
+ */
+
+struct ParsedMessage {        // views into the parsed line
+    std::string_view type;         // e.g. REPLY OK/NOK, MSG/ERR/BYE FROM
+    std::string_view display_name; // Sender
+    std::string_view content;      // Content of the message received
+};
+
+struct Tcp_Transport {
+    using Packet = std::pmr::string; // built on the event arena
+    static constexpr bool is_tcp = true;
+    static constexpr bool needs_confirm = false; // TCP takes care of it
+
+    // msg_id is not part of the text protocol
+    static Packet build_auth(uint16_t, std::string_view username, std::string_view display_name,
+                             std::string_view secret, std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return concat(mr, {"AUTH ", username, " AS ", display_name, " USING ", secret, "\r\n"});
+    }
+
+    static Packet build_join(uint16_t, std::string_view channel_id, std::string_view display_name,
+                             std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return concat(mr, {"JOIN ", channel_id, " AS ", display_name, "\r\n"});
+    }
+
+    static Packet build_msg(uint16_t, std::string_view display_name, std::string_view content, 
+                            bool is_error = false, std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return concat(mr, {is_error ? "ERR FROM " : "MSG FROM ", display_name, " IS ", content, "\r\n"});
+    }
+
+    static Packet build_bye(uint16_t, std::string_view display_name,
+                            std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return concat(mr, {"BYE FROM ", display_name, "\r\n"});
+    }
+
+    static std::optional<ParsedMessage> parse(std::string_view msg);
+
+    // one allocation for the whole message
+    static Packet concat(std::pmr::memory_resource *mr, std::initializer_list<std::string_view> parts) {
+        size_t len = 0;
+        for (auto part : parts) len += part.size();
+        Packet msg(mr);
+        msg.reserve(len);
+        for (auto part : parts) msg += part;
+        return msg;
+    }
+};
+
+struct Udp_Transport {
+    using Packet = Toolkit::Bytes; // built on the event arena
+    static constexpr bool is_tcp = false;
+    static constexpr bool needs_confirm = true; // CONFIRM + retransmissions
+
+    static Packet build_auth(uint16_t msg_id, std::string_view username, std::string_view display_name,
+                             std::string_view secret, std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return Toolkit::build_auth(msg_id, username, display_name, secret, mr);
+    }
+
+    static Packet build_join(uint16_t msg_id, std::string_view channel_id, std::string_view display_name,
+                             std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return Toolkit::build_join(msg_id, channel_id, display_name, mr);
+    }
+
+    static Packet build_msg(uint16_t msg_id, std::string_view display_name, std::string_view content, 
+                            bool is_error = false, std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return Toolkit::build_msg(msg_id, display_name, content, is_error, mr);
+    }
+
+    static Packet build_bye(uint16_t msg_id, std::string_view display_name,
+                            std::pmr::memory_resource *mr = Toolkit::heap()) {
+        return Toolkit::build_bye(msg_id, display_name, mr);
+    }
+
+    // header shared by all messages
+    static uint8_t  get_type  (std::span<const uint8_t> pac) { return pac[0]; }
+    static uint16_t get_msg_id(std::span<const uint8_t> pac) { return (pac[1] << 8) | pac[2]; }
+};
@@ -0,0 +1,49 @@
+/**
+ * @file transport_probe.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <string>
+#include <chrono>
+
+#include "client_init.h"
+
+#define PROBE_ATTEMPTS 3  // UDP sends of the probe BYE before UDP is given up
+#define PROBE_MARGIN 0.9  // UDP has to be at least this much faster to be picked
+#define PROBE_MSG_ID 0xFFF0 // far from the session's msg_ids, in case the server doesn't tell the sockets apart
+
+/**
+ * @brief Picks the transport for -t auto before the session starts.
+ * TCP connects (Happy Eyeballs, see race_connect()) in a thread of its own while
+ * UDP sends a BYE and times its CONFIRM, retransmitting it after the UDP timeout (-d)
+ * up to PROBE_ATTEMPTS times. Only the server may send PING, while a client may
+ * send BYE in any state, so the UDP round trip is a single sample that includes
+ * the server handling a BYE. Both run through Client_Comms from their
+ * own sockets and are closed afterwards. The TCP connection is kept for the session
+ * if TCP wins. A transport that didn't get through loses, so does UDP with a
+ * retransmission, because TCP recovers from loss without stop-and-wait.
+ * Otherwise the lower round trip wins, ties go to TCP.
+ */
+class Transport_Probe {
+    public:
+        Transport_Probe(const Client_Init &config);
+        std::string run(); // "tcp" or "udp"
+        int get_socket() const; // connection of the TCP probe if TCP won, the session keeps it
+
+    private:
+        struct Result {
+            bool reached = false;
+            std::chrono::duration<double, std::milli> rtt{0}; // TCP connect, CONFIRM of the UDP BYE
+            int lost = 0;
+        };
+        const Client_Init &config;
+        Result tcp, udp;
+        int tcp_socket = -1;
+
+        void probe_tcp();
+        void probe_udp();
+};
@@ -0,0 +1,71 @@
+/**
+ * @file uring.h
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define URING_ENTRIES 256
+#define URING_BUF_COUNT 16 // provided receive buffers, power of two
+#define URING_BUF_GROUP 0
+
+/**
+ * @brief Minimal io_uring wrapper over raw syscalls (no liburing dependency).
+ * One submission/completion ring and one ring of provided receive buffers.
+ */
+class Uring {
+    public:
+        static std::unique_ptr<Uring> create(unsigned buf_size); // nullptr if io_uring is unavailable
+        ~Uring();
+        Uring(const Uring&) = delete;
+        Uring& operator=(const Uring&) = delete;
+
+        io_uring_sqe* get_sqe();  // submits queued entries if the ring is full
+        int submit();             // number submitted or -errno
+        int wait(int timeout_ms); // submit and wait for one completion, -ETIME on timeout
+        bool next_cqe(io_uring_cqe &cqe);
+
+        uint8_t* get_buffer(uint16_t bid);
+        void recycle_buffer(uint16_t bid);
+
+    private:
+        Uring() = default;
+        bool setup();
+        bool setup_buffers(unsigned buf_size);
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size);
+
+        int ring_fd = -1;
+
+        // mapped rings
+        void *sq_ptr = nullptr;
+        size_t sq_size = 0;
+        void *cq_ptr = nullptr;
+        size_t cq_size = 0;
+        io_uring_sqe *sqes = nullptr;
+        size_t sqes_size = 0;
+
+        unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        unsigned sq_entries = 0;
+        io_uring_cqe *cqes;
+        unsigned sqe_tail = 0; // entries prepared, not yet published
+
+        // provided buffers
+        io_uring_buf_ring *buf_ring = nullptr;
+        size_t buf_ring_size = 0;
+        std::vector<uint8_t> buf_pool;
+        unsigned buf_size = 0;
+        uint16_t buf_tail = 0;
+};
@@ -7,10 +7,20 @@
 
 #include "client_comms.h"
 #include "tools.h"
+#include "output_writer.h"
+
+#include <utility> // std::exchange
+#include <algorithm> // std::clamp
 
 Client_Comms::Client_Comms(const std::string &hostname, bool protocol, uint16_t port, uint16_t timeout)
     : host_name(hostname), tproto(protocol), port(port), udp_timeout(timeout){}
 
+Client_Comms::~Client_Comms() {
+    if (client_socket != -1) {
+        close(client_socket);
+    }
+}
+
 int Client_Comms::get_socket() {
     return this->client_socket;
 }
@@ -25,20 +35,429 @@ void Client_Comms::connect_set() {
     } else {
         set_udp();
     }
+    if (!capture_path.empty()) {
+        capture_setup();
+    }
+    if (busy_poll) {
+        busy_poll_setup();
+    } else if (want_uring) {
+        uring_init();
+    }
+    if (timestamps) {
+        timestamps_setup();
+    }
+}
+
+void Client_Comms::enable_uring() {
+    this->want_uring = true;
+}
+
+void Client_Comms::enable_busy_poll(int cpu) {
+    this->busy_poll = true;
+    this->busy_cpu = cpu;
+}
+
+void Client_Comms::enable_timestamps() {
+    this->timestamps = true;
+}
+
+int64_t Client_Comms::rx_timestamp() const {
+    return this->rx_stamp;
+}
+
+int64_t Client_Comms::tx_timestamp() const {
+    return this->tx_stamp;
+}
+
+void Client_Comms::enable_capture(const std::string &path) {
+    this->capture_path = path;
+}
+
+void Client_Comms::keep_process() {
+    this->hosted = true;
+}
+
+bool Client_Comms::is_hosted() const {
+    return hosted;
+}
+
+void Client_Comms::adopt_socket(int fd) {
+    this->adopted = fd;
+}
+
+void Client_Comms::enable_keepalive(uint32_t seconds) {
+    this->keepalive = seconds;
+}
+
+void Client_Comms::enable_reconnect() {
+    this->reconnect_mode = true;
+}
+
+bool Client_Comms::connection_lost() const {
+    return lost;
+}
+
+void Client_Comms::connection_closed() 
+{
+    if (reconnect_mode) {
+        flight_recorder.event("CONNECTION LOST");
+        lost = true;
+        return;
+    }
+    (output_writer.get_mode() == Output_Mode::Text ? std::cout : std::cerr) << "ERROR: Server has closed the connection.\n";
+    terminate_connection(ERR_SERVER);
+}
+
+size_t Client_Comms::unacked_bytes() 
+{
+    int outq = 0;
+    if (client_socket != -1 && ioctl(client_socket, SIOCOUTQ, &outq) != 0) {
+        outq = 0; // purged by RST, the session resends what it kept
+    }
+    return outq + tx_pending.size() + tx_inflight.size() + failed_bytes;
+}
+
+uint32_t Client_Comms::tcp_retransmits() const 
+{
+    tcp_info info{};
+    socklen_t len = sizeof(info);
+    if (client_socket == -1 || getsockopt(client_socket, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+        return 0;
+    }
+    return info.tcpi_total_retrans;
+}
+
+/**
+ * @brief TCP connects again to the resolved addresses, UDP keeps its socket and
+ * sends to the original port until the restarted server replies from a new one
+ */
+bool Client_Comms::reconnect() 
+{
+    lost = false;
+    failed_bytes = 0;
+    has_dyn_addr = false;
+    if (!this->tproto) {
+        return true;
+    }
+
+    if (client_socket != -1) {
+        close(client_socket);
+        client_socket = -1;
+    }
+    buffer.clear();
+    rx_queue.clear();
+    tx_pending.clear();
+    tx_inflight.clear();
+    generation++;
+
+    int sock = race_connect();
+    if (sock < 0) {
+        return false;
+    }
+    this->client_socket = sock;
+    if (keepalive) {
+        keepalive_setup();
+    }
+    if (capture) {
+        socklen_t addr_len = sizeof(local_address);
+        getsockname(client_socket, (sockaddr*)&local_address, &addr_len);
+    }
+    if (busy_poll) {
+        busy_poll_setup();
+    } else if (ring) {
+        uring_arm_recv(); // the multishot receive of the old socket has ended with it
+    }
+    if (timestamps) {
+        timestamps_setup();
+    }
+    flight_recorder.event("RECONNECTED");
+    return true;
+}
+
+void Client_Comms::enable_offline() {
+    this->offline = true;
+}
+
+bool Client_Comms::is_offline() const {
+    return offline;
+}
+
+/**
+ * @brief the capture needs the local address before the first send, UDP socket
+ * is bound right away and its address is the one a connected socket would get
+ */
+void Client_Comms::capture_setup() 
+{
+    this->capture = std::make_unique<Pcap_Writer>(capture_path, this->tproto, hosted);
+    socklen_t addr_len = sizeof(local_address);
+
+    if (!this->tproto) {
+        sockaddr_storage any{};
+        any.ss_family = udp_address.ss_family;
+        bind(client_socket, (sockaddr*)&any, Toolkit::address_len(any));
+
+        int probe = socket(udp_address.ss_family, SOCK_DGRAM, 0);
+        if (probe >= 0 && connect(probe, (sockaddr*)&udp_address, Toolkit::address_len(udp_address)) == 0) {
+            getsockname(probe, (sockaddr*)&local_address, &addr_len);
+        }
+        if (probe >= 0) close(probe);
+
+        sockaddr_storage bound{};
+        addr_len = sizeof(bound);
+        getsockname(client_socket, (sockaddr*)&bound, &addr_len);
+        if (local_address.ss_family != bound.ss_family) {
+            local_address = bound;
+        }
+        Toolkit::set_port(local_address, Toolkit::get_port(bound));
+        return;
+    }
+    getsockname(client_socket, (sockaddr*)&local_address, &addr_len);
+}
+
+void Client_Comms::record_frame(bool outbound, const sockaddr_storage &peer, const void *data, size_t len) 
+{
+    uint16_t msg_id = 0xFFFF;
+    if (!this->tproto && len >= 3) {
+        auto pac = static_cast<const uint8_t*>(data);
+        msg_id = (pac[1] << 8) | pac[2];
+    }
+    flight_recorder.record(outbound ? Flight_Recorder::OUT : Flight_Recorder::IN, data, len, msg_id);
+    if (capture) {
+        capture->write(outbound, local_address, peer, static_cast<const uint8_t*>(data), len);
+    }
+}
+
+bool Client_Comms::uses_uring() const {
+    return ring != nullptr;
 }
 
 void Client_Comms::terminate_connection(int ex_code) {
+    if (ex_code != 0) {
+        flight_recorder.event(("EXIT " + std::to_string(ex_code)).c_str());
+        flight_recorder.dump_text();
+    }
+    if (ring) {
+        uring_flush();
+    }
     if (client_socket != -1) {
         close(client_socket);
+        client_socket = -1;
     }
-    exit(ex_code);
+    Toolkit::fail(ex_code, hosted);
+}
+
+/**
+ * @brief waits until stdin (if wanted) or fd is readable, 
+ * fd is replaced by received data with io_uring
+ */
+unsigned Client_Comms::wait_ready(bool want_stdin, int fd, struct timeval *timeout) 
+{
+    if (busy_poll) {
+        return spin_ready(want_stdin, fd, timeout);
+    }
+    if (!ring) {
+        return select_ready(want_stdin, fd, timeout);
+    }
+
+    bool stopping = stop_requested;
+    auto deadline = std::chrono::steady_clock::now();
+    if (timeout) {
+        deadline += std::chrono::seconds(timeout->tv_sec) + std::chrono::microseconds(timeout->tv_usec);
+    }
+
+    while (true) {
+        if (want_stdin && !stdin_armed && !stdin_ready) {
+            uring_arm_stdin();
+        }
+        unsigned ready = 0;
+        if (want_stdin && stdin_ready) ready |= READY_STDIN;
+        if (!rx_queue.empty())         ready |= READY_SOCKET;
+        if (ready) return ready;
+
+        int wait_ms = -1;
+        if (timeout) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            wait_ms = std::max<long long>(left.count(), 0);
+        }
+        int res = uring_wait(wait_ms);
+        if (res == 0 || stop_requested != stopping) return 0; // Ctrl+C, once like EINTR of select()
+        if (res < 0) return READY_ERROR;
+    }
+}
+
+unsigned Client_Comms::wait_until(bool want_stdin, int fd, std::optional<std::chrono::steady_clock::time_point> deadline) 
+{
+    if (!deadline) {
+        return wait_ready(want_stdin, fd, nullptr);
+    }
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(*deadline - std::chrono::steady_clock::now());
+    left = std::max(left, std::chrono::microseconds(0));
+    struct timeval tv;
+    tv.tv_sec = left.count() / 1000000;
+    tv.tv_usec = left.count() % 1000000;
+    return wait_ready(want_stdin, fd, &tv);
+}
+
+bool Client_Comms::read_stdin(Line_Reader &reader) 
+{
+    if (!ring) {
+        return reader.fill();
+    }
+    if (!stdin_ready) return true;
+
+    stdin_ready = false;
+    return reader.feed(stdin_buf.data(), stdin_res);
+}
+
+unsigned Client_Comms::select_ready(bool want_stdin, int fd, struct timeval *timeout) 
+{
+    fd_set rfds;
+    int active;
+    uint32_t dumps = flight_recorder.dump_count();
+    while (true) {
+        FD_ZERO(&rfds);
+        if (want_stdin) {
+            FD_SET(STDIN_FILENO, &rfds);
+        }
+        FD_SET(fd, &rfds);
+        int max_fd = std::max(STDIN_FILENO, fd) + 1;
+
+        active = select(max_fd, &rfds, nullptr, nullptr, timeout); // Linux leaves the remaining time in timeout
+        if (active < 0 && errno == EINTR && flight_recorder.dump_count() != dumps) {
+            dumps = flight_recorder.dump_count(); // SIGUSR2 is no reason to stop waiting
+            continue;
+        }
+        break;
+    }
+    if (active < 0 && errno == EINTR) {
+        return 0; // Ctrl+C, the caller checks stop_requested
+    }
+    if (active < 0) {
+        perror("Select");
+        return READY_ERROR;
+    }
+    unsigned ready = 0;
+    if (FD_ISSET(STDIN_FILENO, &rfds)) ready |= READY_STDIN;
+    if (FD_ISSET(fd, &rfds))           ready |= READY_SOCKET;
+    return ready;
+}
+
+/**
+ * @brief busy polling (-P), spins on non-blocking checks for at most BUSY_POLL_SPIN,
+ * then blocks in select() for the rest of the timeout
+ */
+unsigned Client_Comms::spin_ready(bool want_stdin, int fd, struct timeval *timeout) 
+{
+    bool stopping = stop_requested;
+    auto start = std::chrono::steady_clock::now();
+    auto spin_end = start + std::chrono::milliseconds(BUSY_POLL_SPIN);
+    if (timeout) {
+        auto deadline = start + std::chrono::seconds(timeout->tv_sec) + std::chrono::microseconds(timeout->tv_usec);
+        spin_end = std::min(spin_end, deadline);
+    }
+
+    for (unsigned spins = 0; ; spins++) {
+        unsigned ready = 0;
+        if (fd_readable(fd)) {
+            ready |= READY_SOCKET;
+        }
+        if (want_stdin && spins % BUSY_POLL_STDIN_EVERY == 0) {
+            pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+            if (poll(&pfd, 1, 0) > 0) ready |= READY_STDIN;
+        }
+        if (ready) return ready;
+        if (stop_requested != stopping) return 0; // Ctrl+C, once like EINTR of select()
+        if (std::chrono::steady_clock::now() >= spin_end) break;
+    }
+
+    if (!timeout) {
+        return select_ready(want_stdin, fd, nullptr);
+    }
+    auto left = std::chrono::seconds(timeout->tv_sec) + std::chrono::microseconds(timeout->tv_usec)
+                - std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    left = std::max(left, std::chrono::microseconds(0));
+    struct timeval tv;
+    tv.tv_sec = left.count() / 1000000;
+    tv.tv_usec = left.count() % 1000000;
+    return select_ready(want_stdin, fd, &tv);
+}
+
+bool Client_Comms::fd_readable(int fd) 
+{
+    if (fd == client_socket) {
+        // SO_BUSY_POLL makes the kernel poll the device queue here
+        char probe;
+        if (recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT) >= 0) return true;
+        return errno != EAGAIN && errno != EWOULDBLOCK; // errors are reported by the real receive
+    }
+    pollfd pfd = {fd, POLLIN, 0}; // eventfd of the network thread
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/**
+ * @brief socket and process settings for busy polling, everything except
+ * SO_BUSY_POLL is optional and only done when permitted
+ */
+void Client_Comms::busy_poll_setup() 
+{
+    int usec = BUSY_POLL_USEC;
+    if (setsockopt(client_socket, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) != 0) {
+        perror("WARNING: SO_BUSY_POLL");
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(busy_cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "WARNING: Cannot pin to CPU " << busy_cpu << ": " << strerror(errno) << "\n";
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf_debug("mlockall: %s", strerror(errno));
+    }
+    if (setpriority(PRIO_PROCESS, 0, BUSY_POLL_NICE) != 0) {
+        printf_debug("setpriority: %s", strerror(errno));
+    }
+    printf_debug("Busy polling on CPU %d", busy_cpu);
+}
+
+void Client_Comms::set_resolver_cache(uint32_t ttl) {
+    this->cache = std::make_unique<Resolver_Cache>(ttl);
 }
 
 void Client_Comms::resolve_ip() {
     printf_debug("Resolving hostname...");
+    addresses.clear();
+    from_cache = false;
+    if (cache) {
+        addresses = cache->lookup(host_name);
+        from_cache = !addresses.empty();
+        for (auto &addr : addresses) {
+            Toolkit::set_port(addr, this->port);
+        }
+    }
+    if (addresses.empty()) {
+        resolve_dns();
+    }
+
+    // UDP can't race, the first IPv4 address is kept as before
+    this->udp_address = addresses.front();
+    for (auto &addr : addresses) {
+        if (addr.ss_family == AF_INET) {
+            this->udp_address = addr;
+            break;
+        }
+    }
+    this->ip_address = Toolkit::address_to_string(this->tproto ? addresses.front() : udp_address);
+    printf_debug("Resolved %zu addresses, first = %s, port = %d", addresses.size(), 
+                  ip_address.c_str(), this->port);
+}
+
+void Client_Comms::resolve_dns() 
+{
     struct addrinfo hints{}, *result = nullptr;
     memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_flags = AI_ADDRCONFIG;
 
     if (this->tproto) {
         hints.ai_socktype = SOCK_STREAM;
@@ -48,31 +467,40 @@ void Client_Comms::resolve_ip() {
 
     if (getaddrinfo(host_name.c_str(), nullptr, &hints, &result) != 0) {
         std::cerr << "ERROR: Unable to resolve domain name: " << host_name << "\n";
-        exit(ERR_INVALID);
+        Toolkit::fail(ERR_INVALID, hosted);
     }
 
+    // families alternate, starting with the preferred one (RFC 8305)
+    std::vector<sockaddr_storage> v4, v6;
+    int first_family = result->ai_family;
     for (auto next = result; next != nullptr; next = next->ai_next) {
-        if (next->ai_family == AF_INET) {
-            struct sockaddr_in* ipv4 = (struct sockaddr_in*)next->ai_addr;
-
-            if (this->tproto) {
-                char ip_buf[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &(ipv4->sin_addr), ip_buf, sizeof(ip_buf));
-                this->ip_address = ip_buf;
-            } else {
-                this->udp_address = *ipv4;  // entire sockaddr_in
-                this->udp_address.sin_port = htons(this->port); // add port 
-
-                char buf[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &udp_address.sin_addr, buf, sizeof(buf));
-                printf_debug("Resolved UDP address = %s, port = %d", buf, ntohs(udp_address.sin_port));
+        sockaddr_storage addr{};
+        if (next->ai_family != AF_INET && next->ai_family != AF_INET6) continue;
+        memcpy(&addr, next->ai_addr, next->ai_addrlen);
+        (next->ai_family == AF_INET ? v4 : v6).push_back(addr);
+    }
+    freeaddrinfo(result);
 
-            }
-            break; // Found address
-        }
+    auto &first = first_family == AF_INET6 ? v6 : v4;
+    auto &second = first_family == AF_INET6 ? v4 : v6;
+    addresses.clear();
+    for (size_t i = 0; i < std::max(first.size(), second.size()); i++) {
+        if (i < first.size())  addresses.push_back(first[i]);
+        if (i < second.size()) addresses.push_back(second[i]);
+    }
+    if (addresses.empty()) {
+        std::cerr << "ERROR: Unable to resolve domain name: " << host_name << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
     }
+    for (auto &addr : addresses) {
+        Toolkit::set_port(addr, this->port);
+    }
+    from_cache = false;
     printf_debug("Success, hostname resolved.");
-    freeaddrinfo(result);
+
+    if (cache) {
+        cache->store(host_name, addresses);
+    }
 }
 
 /**
@@ -85,66 +513,217 @@ void Client_Comms::resolve_ip() {
 
 void Client_Comms::connect_tcp() 
 {
-    int family = AF_INET;
-    int type = SOCK_STREAM;
-    int protocol = IPPROTO_TCP;
-    this->client_socket = socket(family, type, protocol);
-
-    struct sockaddr_in server_addr {};
-        server_addr.sin_family = family;
-        server_addr.sin_port = htons(this->port);
-        inet_pton(AF_INET, this->ip_address.c_str(), &server_addr.sin_addr);
-        
-    socklen_t address_size = sizeof(server_addr);
-    struct sockaddr *address = (struct sockaddr*)&server_addr;
-    
-    
-    if (this->client_socket <= 0) {
-        std::cout << "ERROR: Cannot create TCP socket\n";  
-        terminate_connection(ERR_INTERNAL);
+    if (adopted != -1) { // connected already, reconnects race as usual
+        this->client_socket = std::exchange(adopted, -1);
+        socklen_t len = sizeof(peer_address);
+        getpeername(client_socket, reinterpret_cast<sockaddr*>(&peer_address), &len);
+        this->ip_address = Toolkit::address_to_string(peer_address);
+        printf_debug("Using the probed connection to %s", ip_address.c_str());
+        if (keepalive) {
+            keepalive_setup();
+        }
+        return;
     }
-
-    if  (connect(this->client_socket, address, address_size) != 0) {
-        perror("ERROR: Can't connect to socket");
-        std::cout << "ERROR: Cannot connect\n";
+    int sock = race_connect();
+    if (sock < 0 && from_cache) {
+        printf_debug("Cached addresses of %s failed, resolving again", host_name.c_str());
+        resolve_dns();
+        sock = race_connect();
+    }
+    if (sock < 0) {
+        (output_writer.get_mode() == Output_Mode::Text ? std::cout : std::cerr) << "ERROR: Cannot connect\n";
         terminate_connection(ERR_SERVER);
     }
+    this->client_socket = sock;
+    if (keepalive) {
+        keepalive_setup();
+    }
     printf_debug("%s", "TCP Connected succesfully");
 }
 
-void Client_Comms::send_tcp_message(const std::string &msg) {
-    int bytes_tx = send(this->client_socket, msg.c_str(), strlen(msg.c_str()), 0);
+/**
+ * @brief -K, half of the time idle before the first probe, the rest split between
+ * KEEPALIVE_PROBES probes. Unacknowledged data gives up after the whole time
+ * (TCP_USER_TIMEOUT). Either way recv() or send() fails with ETIMEDOUT.
+ */
+void Client_Comms::keepalive_setup() 
+{
+    int on = 1;
+    int count = KEEPALIVE_PROBES;
+    uint32_t half = keepalive / 2;
+    int idle = std::clamp<uint32_t>(half, 1, KEEPALIVE_MAX_IDLE);
+    int interval = std::clamp<uint32_t>((keepalive - half) / count, 1, KEEPALIVE_MAX_IDLE);
+    unsigned user_timeout = keepalive * 1000u; // fits, see KEEPALIVE_MAX
+    if (setsockopt(client_socket, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) != 0
+        || setsockopt(client_socket, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) != 0
+        || setsockopt(client_socket, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) != 0
+        || setsockopt(client_socket, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count)) != 0) {
+        perror("WARNING: TCP keepalive");
+    }
+    if (setsockopt(client_socket, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout)) != 0) {
+        perror("WARNING: TCP_USER_TIMEOUT");
+    }
+    printf_debug("Keepalive after %d s, %d probes every %d s", idle, count, interval);
+}
+
+/**
+ * @brief Happy Eyeballs, non-blocking connects to the addresses in order,
+ * next one starts after CONNECT_STAGGER or right when an attempt fails,
+ * first established connection wins and the rest is closed
+ */
+int Client_Comms::race_connect() 
+{
+    using Clock = std::chrono::steady_clock;
+    struct Attempt {
+        int fd;
+        size_t idx;
+        Clock::time_point started;
+    };
+    std::vector<Attempt> pending;
+    size_t next = 0;
+    auto next_start = Clock::now();
+    int winner = -1;
+    size_t winner_idx = 0;
+
+    while (winner < 0 && (next < addresses.size() || !pending.empty())) {
+        auto now = Clock::now();
+
+        if (next < addresses.size() && (pending.empty() || now >= next_start)) {
+            const sockaddr_storage &addr = addresses[next];
+            size_t idx = next++;
+            int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+            if (fd < 0) {
+                perror("ERROR: Cannot create TCP socket");
+                continue;
+            }
+            printf_debug("Connecting to %s", Toolkit::address_to_string(addr).c_str());
+            if (connect(fd, (const sockaddr*)&addr, Toolkit::address_len(addr)) == 0) {
+                winner = fd;
+                winner_idx = idx;
+                break;
+            }
+            if (errno != EINPROGRESS) {
+                perror("ERROR: Can't connect to socket");
+                close(fd);
+                continue;
+            }
+            pending.push_back({fd, idx, now});
+            next_start = now + std::chrono::milliseconds(CONNECT_STAGGER);
+            continue;
+        }
+
+        // wait until a connect finishes, the next attempt is due or one runs out of time
+        auto deadline = Clock::time_point::max();
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        int max_fd = -1;
+        for (auto &att : pending) {
+            deadline = std::min(deadline, att.started + std::chrono::milliseconds(TCP_TIMEOUT));
+            FD_SET(att.fd, &wfds);
+            max_fd = std::max(max_fd, att.fd);
+        }
+        if (next < addresses.size()) {
+            deadline = std::min(deadline, next_start);
+        }
+        auto left = std::chrono::ceil<std::chrono::microseconds>(deadline - now);
+        left = std::max(left, std::chrono::microseconds(0));
+        struct timeval tv;
+        tv.tv_sec = left.count() / 1000000;
+        tv.tv_usec = left.count() % 1000000;
+
+        if (select(max_fd + 1, nullptr, &wfds, nullptr, &tv) < 0 && errno != EINTR) {
+            perror("Select");
+            break;
+        }
+
+        now = Clock::now();
+        std::vector<Attempt> still;
+        for (auto &att : pending) {
+            if (winner < 0 && FD_ISSET(att.fd, &wfds)) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(att.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err == 0) {
+                    winner = att.fd;
+                    winner_idx = att.idx;
+                    continue;
+                }
+                printf_debug("Connecting to %s failed: %s", 
+                             Toolkit::address_to_string(addresses[att.idx]).c_str(), strerror(err));
+                close(att.fd);
+                next_start = now; // don't wait for the stagger
+                continue;
+            }
+            if (now - att.started >= std::chrono::milliseconds(TCP_TIMEOUT)) {
+                printf_debug("Connecting to %s timed out", Toolkit::address_to_string(addresses[att.idx]).c_str());
+                close(att.fd);
+                continue;
+            }
+            still.push_back(att);
+        }
+        pending = std::move(still);
+    }
+
+    for (auto &att : pending) {
+        if (att.fd != winner) close(att.fd);
+    }
+    if (winner < 0) {
+        return -1;
+    }
+
+    int flags = fcntl(winner, F_GETFL, 0);
+    fcntl(winner, F_SETFL, flags & ~O_NONBLOCK);
+    this->ip_address = Toolkit::address_to_string(addresses[winner_idx]);
+    this->peer_address = addresses[winner_idx];
+    printf_debug("Connected to %s", ip_address.c_str());
+    return winner;
+}
+
+void Client_Comms::send_tcp_message(std::string_view msg) {
+    if (offline) return;
+    record_frame(true, peer_address, msg.data(), msg.size());
+    if (ring) {
+        tx_pending += msg; // coalesced into one send
+        if (tx_inflight.empty()) {
+            uring_send_tcp();
+        }
+        return;
+    }
+    int bytes_tx = send(this->client_socket, msg.data(), msg.size(), MSG_NOSIGNAL);
     if (bytes_tx < 0) {
+        if (reconnect_mode && (errno == EPIPE || errno == ECONNRESET || errno == ETIMEDOUT)) {
+            failed_bytes += msg.size();
+            lost = true;
+            return;
+        }
         std::cerr << "ERROR: Cannot send message: " << msg << "\n";
         return;
     }
 }
 
-std::string Client_Comms::receive_tcp_message() 
+std::pmr::string Client_Comms::receive_tcp_message(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr) 
 {
     while (true) {
         size_t pos = this->buffer.find("\r\n");
         if (pos != std::string::npos) {
-            std::string msg = buffer.substr(0, pos);
+            std::pmr::string msg(buffer.data(), pos, mr);
             buffer.erase(0, pos + 2);
             return msg;
         }
-        receive_tcp_chunk();
+        receive_tcp_chunk(deadline);
+        if (lost) return std::pmr::string(mr);
     }
 }
 
-void Client_Comms::receive_tcp_chunk() {
+void Client_Comms::receive_tcp_chunk(std::chrono::steady_clock::time_point deadline) {
     printf_debug("Getting another TCP message chunk...");
 
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(client_socket, &rfds);
-
-    struct timeval tv;
-    tv.tv_sec = TCP_TIMEOUT / 1000;
-    tv.tv_usec = (TCP_TIMEOUT % 1000) * 1000;
-
-    int ready = select(client_socket + 1, &rfds, nullptr, nullptr, &tv);
+    int ready;
+    if (ring) {
+        ready = uring_wait_rx(deadline);
+    } else {
+        ready = wait_until(false, client_socket, deadline) == READY_SOCKET;
+    }
     if (ready <= 0) {
         std::cerr << "ERROR: recv() timeout or error.\n";
         std::string err = "ERR FROM " + this->ip_address + " IS incomplete message\r\n";
@@ -153,39 +732,71 @@ void Client_Comms::receive_tcp_chunk() {
         return;
     }
 
+    if (ring) {
+        while (!rx_queue.empty()) {
+            std::vector<uint8_t> data = std::move(rx_queue.front().data);
+            rx_stamp = rx_queue.front().stamp;
+            rx_queue.pop_front();
+            if (data.empty()) {
+                connection_closed();
+                return;
+            }
+            record_frame(false, peer_address, data.data(), data.size());
+            buffer.append(data.begin(), data.end());
+        }
+        return;
+    }
+
     char temp[BUFFER_SIZE];
-    int bytes_rx = recv(client_socket, temp, BUFFER_SIZE - 1, 0);
-    if (bytes_rx < 0) {
+    char control[RX_CONTROL_LEN];
+    iovec iov = {temp, BUFFER_SIZE - 1};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int bytes_rx = recvmsg(client_socket, &msg, 0);
+    if (bytes_rx < 0 && errno == ETIMEDOUT) { // -K, the server stopped answering
+        flight_recorder.event("KEEPALIVE TIMEOUT");
+    }
+    if (bytes_rx < 0 && !(reconnect_mode && errno == ECONNRESET) && errno != ETIMEDOUT) {
         perror("ERROR: recv");
         return;
     }
-
-    if (bytes_rx == 0) {
-        std::cout << "ERROR: Server has closed the connection.\n";
-        terminate_connection(ERR_SERVER);
+    if (bytes_rx <= 0) {
+        connection_closed();
         return;
     }
+    read_cmsgs(msg);
 
+    record_frame(false, peer_address, temp, bytes_rx);
     temp[bytes_rx] = '\0';
     buffer += temp;
 }
 
-std::optional<std::string> Client_Comms::timed_tcp_reply() 
+std::optional<std::pmr::string> Client_Comms::timed_tcp_reply(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr) 
 {
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(client_socket, &rfds);
-
-    struct timeval tv;
-    tv.tv_sec = TCP_TIMEOUT / 1000;
-    tv.tv_usec = (TCP_TIMEOUT % 1000) * 1000;
+    if (offline) return std::nullopt; // no socket to wait on
+    if (ring) {
+        if (!uring_wait_rx(deadline)) return std::nullopt;
+        auto msg = receive_tcp_message(deadline, mr);
+        if (lost) return std::nullopt;
+        return msg;
+    }
 
-    int ready = select(client_socket + 1, &rfds, nullptr, nullptr, &tv);
-    if (ready <= 0) {
+    unsigned ready;
+    do { // 0 before the deadline is Ctrl+C, the reply is still waited for
+        ready = wait_until(false, client_socket, deadline);
+    } while (ready == 0 && std::chrono::steady_clock::now() < deadline);
+    if (ready != READY_SOCKET) {
         return std::nullopt;
     }
 
-    return receive_tcp_message();
+    auto msg = receive_tcp_message(deadline, mr);
+    if (lost) return std::nullopt;
+    return msg;
 }
 
 /**
@@ -196,9 +807,21 @@ std::optional<std::string> Client_Comms::timed_tcp_reply()
   *    OOOO   HOOOO   H
 */
 
+void Client_Comms::set_socket_buffer(uint32_t bytes) {
+    this->sock_buf = bytes;
+}
+
+uint32_t Client_Comms::get_rx_dropped() const {
+    return this->rx_dropped;
+}
+
+int Client_Comms::get_rcvbuf() const {
+    return this->rcvbuf;
+}
+
 void Client_Comms::set_udp() 
 {
-    int family = AF_INET;
+    int family = udp_address.ss_family;
     int type = SOCK_DGRAM;
     int protocol = 0;
     this->client_socket = socket(family, type, protocol);
@@ -206,86 +829,468 @@ void Client_Comms::set_udp()
         std::cerr << "ERROR: Cannot create socket.\n";
         terminate_connection(ERR_INTERNAL);
     }
+
+    int bytes = sock_buf ? sock_buf : UDP_BUF_AUTO;
+    set_buffer_size(SO_SNDBUF, SO_SNDBUFFORCE, bytes);
+    set_buffer_size(SO_RCVBUF, SO_RCVBUFFORCE, bytes);
+
+    // every received datagram carries the number of datagrams dropped so far
+    int on = 1;
+    if (setsockopt(client_socket, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) != 0) {
+        perror("WARNING: SO_RXQ_OVFL");
+    }
+}
+
+/**
+ * @brief sets socket buffer size, the FORCE variant ignores net.core.[rw]mem_max 
+ * but needs CAP_NET_ADMIN, otherwise the size is capped by the kernel
+ */
+void Client_Comms::set_buffer_size(int opt, int force_opt, int bytes) 
+{
+    if (setsockopt(client_socket, SOL_SOCKET, force_opt, &bytes, sizeof(bytes)) != 0) {
+        setsockopt(client_socket, SOL_SOCKET, opt, &bytes, sizeof(bytes));
+    }
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    getsockopt(client_socket, SOL_SOCKET, opt, &actual, &len);
+    if (opt == SO_RCVBUF) {
+        this->rcvbuf = actual;
+    }
+    printf_debug("Socket buffer %s = %d (requested %d)", opt == SO_RCVBUF ? "RCV" : "SND", actual, bytes);
+}
+
+void Client_Comms::read_cmsgs(msghdr &msg) 
+{
+    rx_stamp = 0;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) continue;
+
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            scm_timestamping ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            rx_stamp = ts.ts[0].tv_sec * 1000000000LL + ts.ts[0].tv_nsec; // software
+        } 
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            rx_stamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        } 
+        else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t counter;
+            memcpy(&counter, CMSG_DATA(cmsg), sizeof(counter));
+            if (counter == rx_dropped) continue;
+
+            rx_dropped = counter;
+            auto now = std::chrono::steady_clock::now();
+            if (now - drop_warned_at >= std::chrono::milliseconds(DROP_WARN_INTERVAL)) {
+                std::cerr << "WARNING: " << counter - rx_dropped_warned << " datagrams dropped by the kernel.\n";
+                rx_dropped_warned = counter;
+                drop_warned_at = now;
+            }
+            if (sock_buf == 0 && rcvbuf / 2 < UDP_BUF_MAX) { // kernel reports double of the size set
+                set_buffer_size(SO_RCVBUF, SO_RCVBUFFORCE, std::min(rcvbuf, UDP_BUF_MAX));
+            }
+        }
+    }
 }
 
-void Client_Comms::send_udp_message(const std::vector<uint8_t>& pac) 
+/**
+ * @brief software RX timestamps, and TX ones for UDP with select(), they are 
+ * returned through the error queue, which io_uring receives would trip over
+ */
+void Client_Comms::timestamps_setup() 
+{
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (!this->tproto && !ring) {
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_TSONLY;
+    }
+    if (setsockopt(client_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        tx_timestamps = flags & SOF_TIMESTAMPING_TX_SOFTWARE;
+        return;
+    }
+    int on = 1;
+    if (setsockopt(client_socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0) {
+        perror("WARNING: SO_TIMESTAMPNS");
+    }
+}
+
+void Client_Comms::read_tx_timestamps() 
+{
+    char control[CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(sock_extended_err))];
+    while (true) {
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(client_socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) return;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                tx_stamp = ts.ts[0].tv_sec * 1000000000LL + ts.ts[0].tv_nsec;
+                printf_debug("TX timestamp %lld", (long long)tx_stamp);
+            }
+        }
+    }
+}
+
+void Client_Comms::send_udp_message(std::span<const uint8_t> pac) 
 {
     printf_debug("Sending UDP message.");
     send_udp_packet(pac);
 }
 
-void Client_Comms::send_udp_packet(const std::vector<uint8_t>& pac) 
+void Client_Comms::send_udp_packet(std::span<const uint8_t> pac) 
 {
     printf_debug("Sending UDP packet.");
     int flags = 0;
+    if (offline) return;
 
-    sockaddr_in *in_addr = has_dyn_addr ? &dynamic_address : &udp_address;
+    sockaddr_storage *in_addr = has_dyn_addr ? &dynamic_address : &udp_address;
+    record_frame(true, *in_addr, pac.data(), pac.size());
     sockaddr* address = (sockaddr*) in_addr;
 
-    socklen_t address_size = sizeof(*in_addr);
+    socklen_t address_size = Toolkit::address_len(*in_addr);
+
+    if (ring) {
+        auto tx = std::make_unique<Udp_Tx>();
+        tx->data.assign(pac.begin(), pac.end());
+        tx->addr = *in_addr;
+        tx->iov = {tx->data.data(), tx->data.size()};
+        tx->msg.msg_name = &tx->addr;
+        tx->msg.msg_namelen = address_size;
+        tx->msg.msg_iov = &tx->iov;
+        tx->msg.msg_iovlen = 1;
+
+        io_uring_sqe *sqe = ring->get_sqe();
+        if (!sqe) {
+            std::cerr << "ERROR: Cannot send, try again.\n";
+            return;
+        }
+        uint64_t id = udp_tx_id++;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = client_socket;
+        sqe->addr = reinterpret_cast<uint64_t>(&tx->msg);
+        sqe->len = 1;
+        sqe->user_data = TAG_UDP_TX | (id << 8);
+        udp_tx.emplace(id, std::move(tx)); // submitted with the next wait
+        return;
+    }
     
+    tx_stamp = 0;
     int bytes_tx = sendto(this->client_socket, pac.data(), pac.size(), 
                           flags, address, address_size);
     if (bytes_tx < 0) {
         std::cerr << "ERROR: Cannot send, try again.\n";
+    }
+    if (tx_timestamps) {
+        read_tx_timestamps(); // software ones are usually there once sendto() returns
     }                          
     return;
 }
 
-std::vector<uint8_t> Client_Comms::receive_udp_message() 
+Toolkit::Bytes Client_Comms::receive_udp_message(std::pmr::memory_resource *mr) 
 {
     printf_debug("Receiving UDP message.");
-    return receive_udp_packet();              
+    return receive_udp_packet(mr);              
 }
 
-std::vector<uint8_t> Client_Comms::receive_udp_packet() 
+Toolkit::Bytes Client_Comms::receive_udp_packet(std::pmr::memory_resource *mr) 
 {
     printf_debug("Receiving UDP packet...");
 
-    std::vector<uint8_t> data;
+    Toolkit::Bytes data(mr);
+    if (ring) {
+        if (rx_queue.empty()) return data;
+        data.assign(rx_queue.front().data.begin(), rx_queue.front().data.end());
+        rx_stamp = rx_queue.front().stamp;
+        rx_queue.pop_front();
+        record_frame(false, has_dyn_addr ? dynamic_address : udp_address, data.data(), data.size());
+        return data;
+    }
+
     char temp[BUFFER_SIZE];
 
-    sockaddr_in src_addr{};
-    socklen_t addr_len = sizeof(src_addr);
+    sockaddr_storage src_addr{};
+    char control[RX_CONTROL_LEN];
+    iovec iov = {temp, BUFFER_SIZE};
 
-    int bytes_rx = recvfrom(client_socket, temp, BUFFER_SIZE,
-                            0, (sockaddr*)&src_addr, &addr_len);
+    msghdr msg{};
+    msg.msg_name = &src_addr;
+    msg.msg_namelen = sizeof(src_addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int flags = 0;
+    if (tx_timestamps) {
+        read_tx_timestamps(); // a late one makes select() report the socket
+        flags = MSG_DONTWAIT;
+    }
+    int bytes_rx = recvmsg(client_socket, &msg, flags);
 
     if (bytes_rx < 0) 
     {
-        perror("ERROR: recvfrom");
-        return {};
+        if (errno != EAGAIN) perror("ERROR: recvmsg");
+        return data;
+    }
+
+    read_cmsgs(msg);
+    store_dyn_addr(reinterpret_cast<uint8_t*>(temp), src_addr);
+    record_frame(false, src_addr, temp, bytes_rx);
+
+    data.insert(data.end(), temp, temp + bytes_rx); // copying into vector
+    return data;
+}
+
+
+std::optional<Toolkit::Bytes> Client_Comms::timed_udp_reply(std::chrono::steady_clock::time_point deadline, std::pmr::memory_resource *mr) 
+{
+    if (offline) return std::nullopt; // no socket to wait on
+    if (ring) {
+        if (!uring_wait_rx(deadline)) return std::nullopt;
+        return receive_udp_message(mr);
+    }
+
+    while (true) {
+        if (wait_until(false, client_socket, deadline) != READY_SOCKET) {
+            return std::nullopt;
+        }
+
+        auto data = receive_udp_message(mr);
+        if (!data.empty()) return data; // empty after a wakeup by TX timestamp
     }
+}
 
+void Client_Comms::store_dyn_addr(const uint8_t *pac, const sockaddr_storage &src_addr) 
+{
     if (!has_dyn_addr) 
     {
-        if ((uint8_t)temp[0] == 0x01) 
+        if (pac[0] == 0x01) 
         {
             dynamic_address = src_addr;
             has_dyn_addr = true;
-            printf_debug("Stored dynamic server address: port %d", ntohs(src_addr.sin_port));
+            printf_debug("Stored dynamic server address: port %d", Toolkit::get_port(src_addr));
         }
     }
+}
 
-    data.insert(data.end(), temp, temp + bytes_rx); // copying into vector
-    return data;
+/**
+ * io_uring backend (-U)
+ * Receiving is one multishot recv/recvmsg into provided buffers, stdin is one read
+ * re-armed after it was consumed. Sends are queued and submitted together with
+ * the next wait, TCP messages queued while a send is in flight are coalesced.
+*/
+
+void Client_Comms::uring_init() 
+{
+    // recvmsg output header and source address precede the datagram
+    this->ring = Uring::create(BUFFER_SIZE + sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage)
+                               + RX_CONTROL_LEN);
+    if (!ring) {
+        std::cerr << "WARNING: io_uring is not available, using select().\n";
+        return;
+    }
+    rx_msg.msg_namelen = sizeof(sockaddr_storage);
+    rx_msg.msg_controllen = this->tproto ? 0 : RX_CONTROL_LEN;
+    stdin_buf.resize(STDIN_CHUNK);
+
+    uring_arm_recv();
+    ring->submit();
+
+    // multishot receive needs Linux 6.0, older kernels reject it right away
+    io_uring_cqe cqe;
+    std::vector<io_uring_cqe> early;
+    while (ring->next_cqe(cqe)) {
+        if ((cqe.user_data & 0xFF) == TAG_RECV && cqe.res == -EINVAL) {
+            std::cerr << "WARNING: io_uring multishot receive is not supported, using select().\n";
+            ring.reset();
+            return;
+        }
+        early.push_back(cqe);
+    }
+    for (auto &c : early) {
+        uring_complete(c);
+    }
+    printf_debug("Using io_uring");
 }
 
+void Client_Comms::uring_arm_recv() 
+{
+    io_uring_sqe *sqe = ring->get_sqe();
+    if (!sqe) {
+        std::cerr << "ERROR: io_uring submission queue is full.\n";
+        terminate_connection(ERR_INTERNAL);
+    }
+    sqe->opcode = this->tproto ? IORING_OP_RECV : IORING_OP_RECVMSG;
+    sqe->fd = client_socket;
+    if (!this->tproto) {
+        sqe->addr = reinterpret_cast<uint64_t>(&rx_msg);
+        sqe->len = 1;
+    }
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = TAG_RECV | (generation << 8);
+}
 
-std::optional<std::vector<uint8_t>> Client_Comms::timed_udp_reply() 
+void Client_Comms::uring_arm_stdin() 
 {
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(client_socket, &rfds);
+    io_uring_sqe *sqe = ring->get_sqe();
+    if (!sqe) return; // tried again on next wait
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = STDIN_FILENO;
+    sqe->addr = reinterpret_cast<uint64_t>(stdin_buf.data());
+    sqe->len = stdin_buf.size();
+    sqe->off = -1; // current position, works for pipes and terminals
+    sqe->user_data = TAG_STDIN;
+    stdin_armed = true;
+}
 
-    struct timeval tv;
-    tv.tv_sec =  this->udp_timeout / 1000;
-    tv.tv_usec = (this->udp_timeout % 1000) * 1000;
+void Client_Comms::uring_send_tcp() 
+{
+    if (tx_inflight.empty()) {
+        std::swap(tx_inflight, tx_pending);
+    }
+    if (tx_inflight.empty()) return;
 
-    int ready = select(client_socket + 1, &rfds, nullptr, nullptr, &tv);
-    if (ready <= 0) {
-        return std::nullopt;
+    io_uring_sqe *sqe = ring->get_sqe();
+    if (!sqe) {
+        std::cerr << "ERROR: Cannot send message: io_uring queue is full\n";
+        tx_inflight.clear();
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = client_socket;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->addr = reinterpret_cast<uint64_t>(tx_inflight.data());
+    sqe->len = tx_inflight.size();
+    sqe->user_data = TAG_TCP_TX | (generation << 8);
+}
+
+int Client_Comms::uring_wait(int timeout_ms) 
+{
+    int res = ring->wait(timeout_ms);
+    if (res < 0 && res != -ETIME && res != -EINTR) {
+        errno = -res;
+        perror("ERROR: io_uring_enter");
+        return -1;
+    }
+
+    bool handled = false;
+    io_uring_cqe cqe;
+    while (ring->next_cqe(cqe)) {
+        uring_complete(cqe);
+        handled = true;
+    }
+    return (handled || res == -EINTR) ? 1 : 0;
+}
+
+bool Client_Comms::uring_wait_rx(std::chrono::steady_clock::time_point deadline) 
+{
+    while (rx_queue.empty()) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) return false;
+        if (uring_wait(left.count()) <= 0) return false;
+    }
+    return true;
+}
+
+void Client_Comms::uring_complete(const io_uring_cqe &cqe) 
+{
+    switch (cqe.user_data & 0xFF) {
+        case TAG_RECV:
+            uring_recv_done(cqe);
+            break;
+
+        case TAG_STDIN:
+            stdin_armed = false;
+            stdin_ready = true;
+            stdin_res = cqe.res;
+            break;
+
+        case TAG_TCP_TX:
+            if ((cqe.user_data >> 8) != generation) break; // socket closed by reconnect()
+            if (cqe.res < 0) {
+                if (reconnect_mode && (cqe.res == -EPIPE || cqe.res == -ECONNRESET || cqe.res == -ETIMEDOUT)) {
+                    failed_bytes += tx_inflight.size();
+                    lost = true;
+                } else {
+                    std::cerr << "ERROR: Cannot send message: " << strerror(-cqe.res) << "\n";
+                }
+                tx_inflight.clear();
+            } else {
+                tx_inflight.erase(0, cqe.res); // rest of a short send goes again
+            }
+            uring_send_tcp();
+            break;
+
+        case TAG_UDP_TX:
+            if (cqe.res < 0) {
+                std::cerr << "ERROR: Cannot send, try again.\n";
+            }
+            udp_tx.erase(cqe.user_data >> 8);
+            break;
+    }
+}
+
+void Client_Comms::uring_recv_done(const io_uring_cqe &cqe) 
+{
+    bool rearm = !(cqe.flags & IORING_CQE_F_MORE);
+
+    if ((cqe.user_data >> 8) != generation) { // socket closed by reconnect()
+        if (cqe.res >= 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+            ring->recycle_buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+        return;
     }
+    if (cqe.res < 0) {
+        if (this->tproto && (cqe.res == -ETIMEDOUT || (reconnect_mode && cqe.res == -ECONNRESET))) {
+            rx_queue.emplace_back(); // same as closed, ETIMEDOUT by -K
+            return;
+        }
+        if (cqe.res != -ENOBUFS && cqe.res != -EINTR) {
+            std::cerr << "ERROR: recv: " << strerror(-cqe.res) << "\n";
+        }
+    } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        uint8_t *buf = ring->get_buffer(bid);
 
-    return receive_udp_message();
+        if (this->tproto) {
+            rx_queue.push_back({std::vector<uint8_t>(buf, buf + cqe.res)});
+        } else {
+            auto out = reinterpret_cast<io_uring_recvmsg_out*>(buf);
+            uint8_t *name = buf + sizeof(*out);
+            uint8_t *payload = name + rx_msg.msg_namelen + rx_msg.msg_controllen;
+
+            if (out->payloadlen > 0) {
+                sockaddr_storage src_addr{};
+                memcpy(&src_addr, name, std::min<size_t>(out->namelen, sizeof(src_addr)));
+                msghdr ctl{};
+                ctl.msg_control = name + rx_msg.msg_namelen;
+                ctl.msg_controllen = out->controllen;
+                read_cmsgs(ctl);
+                store_dyn_addr(payload, src_addr);
+                rx_queue.push_back({std::vector<uint8_t>(payload, payload + out->payloadlen), rx_stamp});
+            }
+        }
+        ring->recycle_buffer(bid);
+    } else if (cqe.res == 0 && this->tproto) {
+        rx_queue.emplace_back(); // connection closed, empty data
+        return;
+    }
+
+    if (rearm) {
+        uring_arm_recv();
+    }
+}
+
+void Client_Comms::uring_flush() 
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TCP_TIMEOUT);
+    while (!tx_inflight.empty() || !tx_pending.empty() || !udp_tx.empty()) {
+        if (std::chrono::steady_clock::now() >= deadline) break;
+        if (uring_wait(100) < 0) break;
+    }
 }
@@ -8,21 +8,77 @@
 #include "client_init.h"
 #include "tools.h"
 
+#include <sched.h> // CPU_SETSIZE
+
 bool Client_Init::is_tcp() const { return protocol == "tcp"; }
 std::string Client_Init::get_hostname() const { return hostname; }
 uint16_t    Client_Init::get_port()     const { return port; }
 uint16_t    Client_Init::get_timeout()  const { return timeout; }
 uint8_t     Client_Init::get_retries()  const { return retries; }
+std::string Client_Init::get_corpus()   const { return corpus; }
+uint32_t    Client_Init::get_pacing()   const { return pacing; }
+uint32_t    Client_Init::get_rate()     const { return rate; }
+uint32_t    Client_Init::get_burst()    const { return burst; }
+bool        Client_Init::is_threaded()  const { return threaded; }
+bool        Client_Init::use_uring()    const { return uring; }
+uint32_t    Client_Init::get_cache_ttl() const { return cache_ttl; }
+uint32_t    Client_Init::get_sock_buffer() const { return sock_buffer; }
+bool        Client_Init::use_busy_poll() const { return busy_cpu >= 0; }
+int         Client_Init::get_busy_cpu()  const { return busy_cpu; }
+bool        Client_Init::print_latency() const { return latency; }
+std::string Client_Init::get_capture()   const { return capture; }
+std::string Client_Init::get_replay()    const { return replay; }
+std::string Client_Init::get_flight_path() const { return flight_path; }
+uint16_t    Client_Init::get_reorder_wait() const { return reorder_wait; }
+uint16_t    Client_Init::get_reconnect() const { return reconnect; }
+std::string Client_Init::get_journal()   const { return journal; }
+std::string Client_Init::get_history()   const { return history; }
+bool        Client_Init::use_search()    const { return search; }
+std::string Client_Init::get_ingest()    const { return ingest; }
+Output_Mode Client_Init::get_output()    const { return output; }
+int         Client_Init::get_probed_socket() const { return probed_socket; }
+bool        Client_Init::is_auto()     const { return protocol == "auto"; }
+uint32_t    Client_Init::get_keepalive() const { return keepalive; }
+
+/**
+ * @brief settings of a session opened by /open, network options are kept,
+ * files get the session name appended, messages from file or ring and the
+ * waiting backend (-U, -P) stay with the main session
+ */
+Client_Init Client_Init::for_session(const std::string &name, const std::string &protocol,
+                                     const std::string &host, uint16_t port) const
+{
+    Client_Init session = *this;
+    session.protocol = protocol;
+    session.hostname = host;
+    session.port = port;
+    session.corpus.clear();
+    session.replay.clear();
+    session.ingest.clear();
+    session.uring = false;
+    session.busy_cpu = -1;
+    session.probed_socket = -1;
+    if (!capture.empty()) session.capture = capture + "." + name;
+    if (!journal.empty()) session.journal = journal + "." + name;
+    if (!history.empty()) session.history = history + "/" + name;
+    return session;
+}
 
 void Client_Init::set_protocol(std::string protocol) 
 {
-    if (protocol != "tcp" && protocol != "udp") {
+    if (protocol != "tcp" && protocol != "udp" && protocol != "auto") {
         std::cerr << "Error: " << protocol << " is not valid\n";
         exit(ERR_INVALID);
     }
     this->protocol = protocol;
 }
 
+void Client_Init::set_probed(std::string protocol, int socket)
+{
+    this->protocol = protocol;
+    this->probed_socket = socket;
+}
+
 void Client_Init::set_hostname(std::string host) 
 {
     this->hostname = host;
@@ -46,20 +102,178 @@ void Client_Init::set_udp_retries(std::string retries)
     this->retries = static_cast<uint8_t>(r);
 }
 
+void Client_Init::set_corpus(std::string path) 
+{
+    this->corpus = path;
+}
+
+void Client_Init::set_pacing(std::string gap) 
+{
+    int g = Toolkit::catch_stoi(gap, std::numeric_limits<int>::max(), "Pacing");
+    this->pacing = static_cast<uint32_t>(g);
+}
+
+void Client_Init::set_rate(std::string spec) 
+{
+    size_t colon = spec.find(':');
+    int r = Toolkit::catch_stoi(spec.substr(0, colon), std::numeric_limits<int>::max(), "Rate");
+    this->rate = static_cast<uint32_t>(r);
+    if (colon != std::string::npos) {
+        int b = Toolkit::catch_stoi(spec.substr(colon + 1), std::numeric_limits<int>::max(), "Burst");
+        this->burst = static_cast<uint32_t>(b);
+    }
+}
+
+void Client_Init::set_keepalive(std::string seconds) 
+{
+    int k = Toolkit::catch_stoi(seconds, KEEPALIVE_MAX, "Keepalive");
+    this->keepalive = static_cast<uint32_t>(k);
+}
+
+void Client_Init::set_threaded(bool threaded) 
+{
+    this->threaded = threaded;
+}
+
+void Client_Init::set_uring(bool uring) 
+{
+    this->uring = uring;
+}
+
+void Client_Init::set_cache_ttl(std::string ttl) 
+{
+    int t = Toolkit::catch_stoi(ttl, std::numeric_limits<int>::max(), "Resolver cache TTL");
+    this->cache_ttl = static_cast<uint32_t>(t);
+}
+
+void Client_Init::set_sock_buffer(std::string bytes) 
+{
+    int b = Toolkit::catch_stoi(bytes, std::numeric_limits<int>::max(), "Socket buffer");
+    this->sock_buffer = static_cast<uint32_t>(b);
+}
+
+void Client_Init::set_busy_poll(std::string cpu) 
+{
+    this->busy_cpu = Toolkit::catch_stoi(cpu, CPU_SETSIZE - 1, "CPU");
+}
+
+void Client_Init::set_latency(bool latency) 
+{
+    this->latency = latency;
+}
+
+void Client_Init::set_capture(std::string path) 
+{
+    this->capture = path;
+}
+
+void Client_Init::set_replay(std::string path) 
+{
+    this->replay = path;
+}
+
+void Client_Init::set_flight_path(std::string path) 
+{
+    this->flight_path = path;
+}
+
+void Client_Init::set_reorder_wait(std::string wait) 
+{
+    int w = Toolkit::catch_stoi(wait, std::numeric_limits<uint16_t>::max(), "Reorder wait");
+    this->reorder_wait = static_cast<uint16_t>(w);
+}
+
+void Client_Init::set_reconnect(std::string attempts) 
+{
+    int a = Toolkit::catch_stoi(attempts, std::numeric_limits<uint16_t>::max(), "Reconnect attempts");
+    this->reconnect = static_cast<uint16_t>(a);
+}
+
+void Client_Init::set_journal(std::string path) 
+{
+    this->journal = path;
+}
+
+void Client_Init::set_history(std::string dir) 
+{
+    this->history = dir;
+}
+
+void Client_Init::set_search(bool search) 
+{
+    this->search = search;
+}
+
+void Client_Init::set_ingest(std::string name) 
+{
+    if (name.empty() || name.find('/') != std::string::npos) {
+        std::cerr << "Error: " << name << " is not a valid ring name\n";
+        exit(ERR_INVALID);
+    }
+    this->ingest = name;
+}
+
+void Client_Init::set_output(std::string mode) 
+{
+    if (mode == "text") {
+        this->output = Output_Mode::Text;
+    } else if (mode == "ndjson") {
+        this->output = Output_Mode::Ndjson;
+    } else if (mode == "binary") {
+        this->output = Output_Mode::Binary;
+    } else {
+        std::cerr << "Error: " << mode << " is not a valid output mode\n";
+        exit(ERR_INVALID);
+    }
+}
+
 void Client_Init::print_help() 
 {
-    std::cout << "Usage: ./ipk25chat-client -t <tcp|udp> -s <hostname|ip> [-p port] [-d timeout] [-r retries] [-h]\n\n"
+    std::cout << "Usage: ./ipk25chat-client -t <tcp|udp|auto> -s <hostname|ip> [-p port] [-d timeout] [-r retries]\n"
+    << "                        [-f file] [-w pacing] [-T] [-U] [-R ttl] [-b bytes]\n"
+    << "                        [-P cpu] [-L] [-c capture] [-C capture]\n"
+    << "                        [-F dump] [-O wait] [-A attempts] [-J journal]\n"
+    << "                        [-H dir] [-S] [-I ring] [-o mode] [-B rate[:burst]]\n"
+    << "                        [-K seconds] [-h]\n\n"
     << "Options:\n"
-    << "  -t <proto>     Set transport protocol (tcp or udp). Required.\n"
+    << "  -t <proto>     Set transport protocol (tcp, udp or auto). Required. auto measures\n"
+    << "                 both at start and picks the faster one, see transport_probe.h.\n"
     << "  -s <server>    Set server IP address or hostname. Required.\n"
     << "  -p <port>      Set server port (default: 4567).\n"
     << "  -d <timeout>   Set UDP confirmation timeout in ms (default: 250).\n"
     << "  -r <retries>   Set number of UDP retransmissions (default: 3).\n"
+    << "  -f <file>      Send every line of file as a message once authenticated.\n"
+    << "  -w <pacing>    Pause between messages from file in us (default: 0).\n"
+    << "  -T             Handle UDP confirmations and retransmissions in a separate thread.\n"
+    << "  -U             Use io_uring for socket and stdin I/O when available.\n"
+    << "  -R <ttl>       Cache resolved server addresses for ttl seconds.\n"
+    << "  -b <bytes>     UDP socket buffer size (default: auto-sized, grows on drops).\n"
+    << "  -P <cpu>       Busy poll the socket instead of waiting, pinned to the given CPU.\n"
+    << "  -L             Print round-trip latency statistics on exit.\n"
+    << "  -c <file>      Write sent and received packets to a pcap file.\n"
+    << "  -C <file>      Replay received messages of a pcap file offline, -s is not needed.\n"
+    << "  -F <path>      Flight recorder dump path without extension (default: /tmp/ipk25chat-flight-<pid>).\n"
+    << "  -O <wait>      Show UDP messages in msg_id order, holding them at most wait ms.\n"
+    << "  -A <attempts>  Reconnect (with backoff) when the server goes away, then AUTH, JOIN and resend.\n"
+    << "  -J <file>      Keep outgoing messages in a journal until delivered, send leftovers on start.\n"
+    << "  -H <dir>       Keep a history log per channel in dir, shown by /history.\n"
+    << "  -S             Index sent and received messages for /search.\n"
+    << "  -I name        Send messages posted by local processes to the shared-memory\n"
+    << "                 ring /dev/shm/name, see shm_ring.h.\n"
+    << "  -o <mode>      Received messages as text (default), ndjson or binary records,\n"
+    << "                 also --output=<mode>. Other output goes to stderr then.\n"
+    << "  -B <rate>      Send at most rate messages per second, bursts of up to burst\n"
+    << "                 (rate:burst, default rate/10). Slows down on retransmissions.\n"
+    << "  -K <seconds>   Detect a dead server within about seconds: TCP keepalive and\n"
+    << "                 TCP_USER_TIMEOUT, over UDP nothing received (PINGs included).\n"
+    << "                 At most 2147483 (TCP_USER_TIMEOUT is an int in ms).\n"
     << "  -h             Show this help message and exit.\n\n"
     << "Examples:\n"
     << "  ./ipk25chat-client -t tcp -s 127.0.0.1\n"
     << "  ./ipk25chat-client -t udp -s ipk.fit.vutbr.cz -p 10000\n"
-    << "  ./ipk25chat-client -t udp -s 127.0.0.1 -p 3000 -d 100 -r 1\n";
+    << "  ./ipk25chat-client -t udp -s 127.0.0.1 -p 3000 -d 100 -r 1\n"
+    << "  ./ipk25chat-client -t tcp -s 127.0.0.1 -f corpus.txt -w 1000\n"
+    << "  ./ipk25chat-client -t udp -C incident.pcap > /dev/null\n";
     exit(0);
 }
 
@@ -70,8 +284,62 @@ void Client_Init::validate()
     printf_debug("Port:      %u", port);
     printf_debug("Timeout:   %u ms", timeout);
     printf_debug("Retries:   %u", retries);
-    if (this->protocol == "" || this->hostname == "" ) {
+    printf_debug("Corpus:    %s", corpus.c_str());
+    printf_debug("Pacing:    %u us", pacing);
+    printf_debug("Rate:      %u msg/s, burst %u", rate, burst);
+    printf_debug("Threaded:  %d", threaded);
+    printf_debug("io_uring:  %d", uring);
+    printf_debug("Cache TTL: %u s", cache_ttl);
+    printf_debug("Sock buf:  %u B", sock_buffer);
+    printf_debug("Busy CPU:  %d", busy_cpu);
+    printf_debug("Capture:   %s", capture.c_str());
+    printf_debug("Replay:    %s", replay.c_str());
+    printf_debug("Flight:    %s", flight_path.c_str());
+    printf_debug("Reorder:   %u ms", reorder_wait);
+    printf_debug("Reconnect: %u", reconnect);
+    printf_debug("Journal:   %s", journal.c_str());
+    printf_debug("History:   %s", history.c_str());
+    printf_debug("Search:    %d", search);
+    printf_debug("Ingest:    %s", ingest.c_str());
+    printf_debug("Output:    %d", static_cast<int>(output));
+    printf_debug("Keepalive: %u s", keepalive);
+    if (this->protocol == "" || (this->hostname == "" && this->replay == "")) {
         std::cout << "Protocol or IP not selected, display help with '-h'.\n";
         exit(ERR_INVALID);
     }
+    if (this->protocol == "auto") { // main() probes before validate() when there is a server
+        std::cerr << "Error: -t auto needs a server, -C replays offline\n";
+        exit(ERR_INVALID);
+    }
+    if (this->rate && !this->burst) {
+        this->burst = std::max(1u, this->rate / 10);
+    } else if (!this->rate && this->burst) {
+        std::cerr << "WARNING: burst without rate has no effect.\n";
+    }
+    if (this->reorder_wait && is_tcp()) {
+        std::cerr << "WARNING: -O has no effect with TCP.\n";
+    }
+    if (this->threaded && is_tcp()) {
+        std::cerr << "WARNING: -T has no effect with TCP.\n";
+    }
+    if (this->threaded && this->reconnect && !is_tcp()) {
+        std::cerr << "WARNING: -A can't be used with -T, exiting when the server goes away.\n";
+        this->reconnect = 0;
+    }
+    if (!this->journal.empty() && !this->replay.empty()) {
+        std::cerr << "WARNING: -J has no effect with -C.\n";
+    }
+    if (this->threaded && this->uring && !is_tcp()) {
+        std::cerr << "WARNING: -U can't be used with -T, using select().\n";
+        this->uring = false;
+    }
+    if (use_busy_poll() && this->uring) {
+        std::cerr << "WARNING: -U can't be used with -P, using busy polling.\n";
+        this->uring = false;
+    }
+    if (!this->ingest.empty() && (this->uring || use_busy_poll())) {
+        std::cerr << "WARNING: -U and -P can't be used with -I, using select().\n";
+        this->uring = false;
+        this->busy_cpu = -1;
+    }
 }
@@ -8,24 +8,33 @@
 #include "client_session.h"
 #include "tools.h"
 
-Client_Session* Client_Session::active_instance = nullptr;
 
-Client_Session::Client_Session(const Client_Init &config)
+template <typename Transport>
+Client_Session<Transport>::Client_Session(const Client_Init &config)
     : config(config) {
-    active_instance = this;
     this->comms = std::make_unique<Client_Comms>(
-        config.get_hostname(), config.is_tcp(), config.get_port(),
+        config.get_hostname(), Transport::is_tcp, config.get_port(),
         config.get_timeout());
+    if (config.print_latency()) {
+        rtt.reserve();
+        rtt_network.reserve();
+        rtt_client.reserve();
+    }
     }
 
 std::atomic<bool> stop_requested = false;
 
-void Client_Session::print_local_help() {
-    std::cout << "-----------------------------------------\n"
+template <typename Transport>
+void Client_Session<Transport>::print_local_help() {
+    out() << "-----------------------------------------\n"
               << "Supported commands:\n"
               << "  /auth <username> <secret> <displayname>\n"
               << "  /join <channel>\n"
               << "  /rename <displayname>\n"
+              << "  /history [count]\n"
+              << "  /search <words> [from:<name>]\n"
+              << "  /open <name> tcp|udp <host> <port>\n"
+              << "  /switch [name]\n"
               << "  /help\n"
               << "Status:\n"
               << "  Current display name: " << this->display_name << "\n"
@@ -33,118 +42,559 @@ void Client_Session::print_local_help() {
               << "-----------------------------------------\n";
 }
 
-void Client_Session::handle_sigint(int) {
+/**
+ * @brief only sets the flag, a handler interrupting e.g. a journal append can't safely exit,
+ * waits return and run() ends the session after the loop
+ */
+template <typename Transport>
+void Client_Session<Transport>::handle_sigint(int) {
     stop_requested = true;
-    if (active_instance) {
-        active_instance->graceful_exit();
-    }
 }
 
-void Client_Session::graceful_exit(int ex_code) {
-    if (config.is_tcp() == true) {
-        std::string bye_msg = "BYE FROM " + this->display_name + "\r\n";
-        comms->send_tcp_message(bye_msg);
+template <typename Transport>
+void Client_Session<Transport>::graceful_exit(int ex_code) {
+    if constexpr (Transport::needs_confirm) {
+        if (udp.reorder) { // held messages are shown before leaving
+            std::vector<std::vector<uint8_t>> ready;
+            udp.reorder->flush(ready);
+            dispatch_reordered(ready);
+            if (udp.reorder->skipped() > 0) {
+                std::cerr << "Reorder buffer skipped " << udp.reorder->skipped() << " missing msg_ids\n";
+            }
+        }
+    }
+    if constexpr (Transport::needs_confirm) {
+        if (net && net->running()) {
+            net->stop(!stop_requested); // queued messages are delivered unless interrupted, BYE is sent directly
+
+            Net_Event ev;
+            while (net->next_event(ev)) {
+                if (ev.type == Net_Event::Type::Confirmed) {
+                    confirmed(ev.msg_id);
+                } else if (ev.type == Net_Event::Type::GaveUp && ex_code == 0) {
+                    std::cerr << "ERROR: No reply for msg_id " << ev.msg_id << ", giving up.\n";
+                    ex_code = ERR_TIMEOUT;
+                }
+            }
+        }
+    }
+    if (pacer && pacer->back_offs() > 0) {
+        std::cerr << "Pacing backed off " << pacer->back_offs() << " times, "
+                  << pacer->current_rate() << " msg/s at exit\n";
+    }
+    if (hub) {
+        hub->close_all(); // opened sessions say BYE first
+    }
+    auto bye_msg = Transport::build_bye(comms->next_msg_id(), this->display_name, &arena);
+    send_message(bye_msg);
+    if constexpr (Transport::needs_confirm) {
+        if (comms->get_rx_dropped() > 0) {
+            std::cerr << "Kernel dropped " << comms->get_rx_dropped() << " received datagrams, "
+                      << "receive buffer " << comms->get_rcvbuf() << " bytes\n";
+        }
     }
-    else {
-        auto bye_msg = Toolkit::build_bye(comms->next_msg_id(), this->display_name);
-        send_message(bye_msg);
+    if (capture_stats.active) {
+        print_capture_summary();
+    }
+    if (journal) { // read but not sent yet, goes out on the next start
+        for (auto &queued : outbox) {
+            if (queued.journal_id == 0) journal->append(queued.content);
+        }
+        std::string line;
+        while (stdin_reader.next_line(line)) {
+            if (!line.empty() && line[0] != '/' && check_message_content(line, MessageContent)) {
+                journal->append(line);
+            }
+        }
+        journal->sync(true);
+        if (journal->pending() > 0) {
+            std::cerr << journal->pending() << " undelivered messages kept in " << config.get_journal() << "\n";
+        }
+    }
+    if (config.print_latency()) {
+        rtt.print(std::cerr, Transport::is_tcp ? "REPLY round trip" : "CONFIRM round trip");
+        rtt_network.print(std::cerr, "  network and server");
+        rtt_client.print(std::cerr, "  client");
+        arena.print(std::cerr);
     }
     comms->terminate_connection(ex_code);  // closes socket and exits
 }
 
-void Client_Session::run(){
-    fd_set rfds;
+template <typename Transport>
+void Client_Session<Transport>::set_state(ClientState next) 
+{
+    static const char *names[] = {"STATE Start", "STATE Auth", "STATE Open", "STATE Join"};
+    flight_recorder.event(names[static_cast<int>(next)]);
+    if (this->state == ClientState::Auth && next == ClientState::Start) {
+        restore.username.clear(); // refused, not replayed after reconnecting
+    }
+    if (next == ClientState::Auth || next == ClientState::Join) {
+        timers.reschedule(reply_timer, std::chrono::steady_clock::now() + std::chrono::milliseconds(REPLY_TIMEOUT));
+    } else {
+        timers.cancel(reply_timer);
+    }
+    this->state = next;
+}
+
+template <typename Transport>
+void Client_Session<Transport>::run(){
     std::string cmd_buffer;
+    bool stdin_open = true;
 
     std::signal(SIGINT, handle_sigint);
-    comms->resolve_ip();
-    comms->connect_set();
-    this->state = ClientState::Start;
+    std::signal(SIGUSR2, Flight_Recorder::handle_sigusr2);
+    if (!config.get_flight_path().empty()) {
+        flight_recorder.set_path(config.get_flight_path());
+    }
+    this->hub = std::make_unique<Session_Hub>(config);
+    output_writer.set_mode(config.get_output());
+    start();
 
     while(true) {
-        FD_ZERO(&rfds);
-        FD_SET(STDIN_FILENO, &rfds);
-        FD_SET(comms->get_socket(), &rfds);
-        int max_fd = std::max(STDIN_FILENO, comms->get_socket()) + 1;
-        printf_debug("Waiting on stdin (%d) and socket (%d)", STDIN_FILENO, comms->get_socket());
-        int active = select(max_fd, &rfds, nullptr, nullptr, nullptr);
-
-        if (active < 0) {
-            perror("Select");
+        arena.reset(); // nothing allocated from it survives an iteration
+
+        auto wake_up = next_wake_up();
+        output_writer.flush(); // records of this iteration, before sleeping
+        unsigned ready;
+        // the pipe holds the rest, also while a waiting line is held back (-B, REPLY)
+        bool blocked = hub->guest_active() ? hub->input_blocked() : input_blocked();
+        bool want_stdin = stdin_open && !stdin_reader.full() && !(blocked && stdin_reader.has_line());
+        if (hub->empty() && !ingest) {
+            printf_debug("Waiting on stdin (%d) and socket (%d), %zu timers", STDIN_FILENO, event_fd(), timers.size());
+            ready = comms->wait_until(want_stdin, event_fd(), wake_up);
+        } else { // more descriptors than the backends of Client_Comms wait on
+            ready = hub->wait(want_stdin, event_fd(), ingest ? ingest->doorbell_fd() : -1, hub->next_wake_up(wake_up));
+        }
+
+        if (ready & READY_ERROR) {
             break;
         }
         
-        if (FD_ISSET(STDIN_FILENO, &rfds)) {
-            if (!std::getline(std::cin, cmd_buffer)) {
-                graceful_exit(); // Ctrl+D or error
-            }
-    
+        if (ready & READY_STDIN) {
+            stdin_open = comms->read_stdin(stdin_reader);
+        }
+
+        receive(ready);
+        hub->receive();
+
+        // every complete line of the chunk, select() won't report them again
+        while (!(hub->guest_active() ? hub->input_blocked() : input_blocked()) && stdin_reader.next_line(cmd_buffer)) {
             if (cmd_buffer.empty()) continue;
-    
-            if (cmd_buffer[0] == '/') { handle_command(cmd_buffer); } 
-            else {  handle_chat_msg(cmd_buffer); }
-        }
-
-        if (FD_ISSET(comms->get_socket(), &rfds)) {
-            if (config.is_tcp()) {
-                comms->receive_tcp_chunk();
-                
-                while (true) {
-                    size_t pos = comms->buffer.find("\r\n");
-                    if (pos == std::string::npos) break;
-                
-                    std::string msg = comms->buffer.substr(0, pos);
-                    comms->buffer.erase(0, pos + 2);
-                    handle_tcp_response(msg);
-                }
-                
+
+            arena.reset();
+            if (hub->guest_active() && !Session_Hub::is_hub_command(cmd_buffer)) {
+                hub->handle_line(cmd_buffer);
             } else {
-                std::vector<uint8_t> udp_msg = comms->receive_udp_message();
-                handle_udp_response(udp_msg);
+                handle_line(cmd_buffer);
             }
         }
+
+        flush();
+        hub->flush();
+
+        // messages from file or journal are still sent after Ctrl+D, unless we can't authenticate,
+        // with a ring the client runs until Ctrl+C
+        if (!stdin_open && !stdin_reader.pending()
+            && ((!replay_pending() && outbox.empty() && !ingest) || this->state == ClientState::Start)) {
+            graceful_exit(); // Ctrl+D or error
+        }
         if (stop_requested) break;
     }
+    if (stop_requested) {
+        graceful_exit(); // Ctrl+C, this session and the ones opened from it
+    }
 }
 
-void Client_Session::handle_chat_msg(const std::string &line) {
+/**
+ * @brief everything before the event loop, also for sessions opened by /open
+ */
+template <typename Transport>
+void Client_Session<Transport>::start()
+{
+    if (!config.get_history().empty()) {
+        this->history = std::make_unique<History_Log>(config.get_history(), comms->is_hosted());
+        history->open_channel(HISTORY_DEFAULT_CHANNEL);
+    }
+    if (config.use_search()) {
+        this->search = std::make_unique<Search_Index>();
+    }
+    if (!config.get_replay().empty()) {
+        replay_capture(); // exits
+        return;
+    }
+    if (!config.get_corpus().empty()) {
+        load_corpus();
+    }
+    if (config.get_cache_ttl() > 0) {
+        comms->set_resolver_cache(config.get_cache_ttl());
+    }
+    comms->resolve_ip();
+    if (config.use_uring()) {
+        comms->enable_uring();
+    }
+    comms->set_socket_buffer(config.get_sock_buffer());
+    if (config.use_busy_poll()) {
+        comms->enable_busy_poll(config.get_busy_cpu());
+    }
+    if (config.print_latency() && !(Transport::needs_confirm && config.is_threaded())) {
+        comms->enable_timestamps();
+    }
+    if (!config.get_capture().empty()) {
+        comms->enable_capture(config.get_capture());
+    }
+    if (config.get_reconnect() > 0) {
+        comms->enable_reconnect();
+    }
+    if (!config.get_journal().empty()) {
+        open_journal();
+    }
+    if (!config.get_ingest().empty()) {
+        this->ingest = Shm_Ring::create(config.get_ingest());
+    }
+    if (config.get_rate() > 0) {
+        this->pacer = std::make_unique<Token_Bucket>(config.get_rate(), config.get_burst());
+    }
+    if (config.get_keepalive() > 0) {
+        comms->enable_keepalive(config.get_keepalive());
+    }
+    if (config.get_probed_socket() != -1) {
+        comms->adopt_socket(config.get_probed_socket()); // -t auto connected already
+    }
+    comms->connect_set();
+    set_state(ClientState::Start);
+
+    if constexpr (Transport::needs_confirm) {
+        if (config.get_reorder_wait() > 0) {
+            udp.reorder = std::make_unique<Reorder_Buffer>(std::chrono::milliseconds(config.get_reorder_wait()));
+        }
+        if (config.is_threaded()) {
+            this->net = std::make_unique<Net_Thread>(*comms, config.get_timeout(), config.get_retries());
+            net->start();
+        }
+    }
+}
+
+// lines after /auth or /join wait until the REPLY is processed (UDP), at most REPLY_TIMEOUT
+template <typename Transport>
+bool Client_Session<Transport>::awaiting_reply() const
+{
+    return (this->state == ClientState::Auth || this->state == ClientState::Join)
+           && timers.pending(reply_timer);
+}
+
+// JOIN and resent messages go before new lines from stdin
+template <typename Transport>
+bool Client_Session<Transport>::resume_pending() const
+{
+    return this->state == ClientState::Open && (restore.rejoin || !outbox.empty());
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::input_blocked() const
+{
+    return awaiting_reply() || resume_pending() || (pacer && !pacer->ready());
+}
+
+/**
+ * @brief arms the timers that follow the session state, returns when the loop has to wake up
+ */
+template <typename Transport>
+std::optional<std::chrono::steady_clock::time_point> Client_Session<Transport>::next_wake_up()
+{
+    // the next message from file and the oldest reorder gap follow their state,
+    // the loop waits until the next timer, indefinitely if there is none
+    bool paced = pacer && !pacer->ready();
+    if (replay_pending() && this->state == ClientState::Open) {
+        timers.reschedule(replay_timer, paced ? std::max(replay.next_send, pacer->ready_at()) : replay.next_send);
+    } else {
+        timers.cancel(replay_timer);
+    }
+    if (paced) {
+        timers.reschedule(pace_timer, pacer->ready_at());
+    } else {
+        timers.cancel(pace_timer);
+    }
+    if (journal && journal->sync_due()) {
+        timers.reschedule(journal_timer, *journal->sync_due()); // flush() syncs once it is due
+    } else {
+        timers.cancel(journal_timer);
+    }
+    if constexpr (Transport::needs_confirm) {
+        if (config.get_keepalive() && this->state == ClientState::Open) {
+            timers.reschedule(liveness_timer, heard_at() + std::chrono::seconds(config.get_keepalive()));
+        } else {
+            timers.cancel(liveness_timer);
+        }
+        if (udp.reorder && udp.reorder->deadline()) {
+            timers.reschedule(reorder_timer, *udp.reorder->deadline(), [this] {
+                std::vector<std::vector<uint8_t>> ready;
+                udp.reorder->expire(ready);
+                dispatch_reordered(ready);
+            });
+        } else {
+            timers.cancel(reorder_timer);
+        }
+    }
+    // messages left to index are taken a batch per iteration, without sleeping in between
+    bool indexing = search && search->index_pending(SEARCH_BATCH);
+    // same for the ring, producers ring the doorbell only once it is empty
+    bool posted = ingest && this->state == ClientState::Open && !paced && !ingest->sleep();
+    if (resume_pending() || indexing || posted) {
+        return std::chrono::steady_clock::now();
+    }
+    return timers.next_expiry();
+}
+
+/**
+ * @brief handles the socket if ready and the due timers, then resumes the session if it can
+ */
+template <typename Transport>
+void Client_Session<Transport>::receive(unsigned ready)
+{
+    if (ingest) {
+        ingest->wake(ready & READY_DOORBELL);
+    }
+    if (ready & READY_SOCKET) {
+        if constexpr (Transport::is_tcp) {
+            comms->receive_tcp_chunk(std::chrono::steady_clock::now() + std::chrono::milliseconds(TCP_TIMEOUT));
+        } else if (net && net->running()) {
+            handle_net_events();
+        } else {
+            Toolkit::Bytes udp_msg = comms->receive_udp_message(&arena);
+            if (!udp_msg.empty()) {
+                handle_udp_response(udp_msg);
+            }
+        }
+    }
+
+    timers.advance(std::chrono::steady_clock::now());
+    if constexpr (Transport::needs_confirm) {
+        if (config.get_keepalive() && this->state == ClientState::Open) {
+            check_liveness();
+        }
+    }
+
+    // timed_tcp_reply() may have buffered more than just the REPLY
+    if constexpr (Transport::is_tcp) {
+        while (true) {
+            size_t pos = comms->buffer.find("\r\n");
+            if (pos == std::string::npos) break;
+        
+            arena.reset(); // one event per message, a chunk can hold thousands
+            std::pmr::string msg(comms->buffer.data(), pos, &arena);
+            comms->buffer.erase(0, pos + 2);
+            handle_tcp_response(msg);
+        }
+        if (comms->connection_lost()) {
+            connection_lost();
+        }
+    }
+
+    resume_session();
+}
+
+/**
+ * @brief after the lines from stdin, sends from file and syncs the journal
+ */
+template <typename Transport>
+void Client_Session<Transport>::flush()
+{
+    if (ingest && this->state == ClientState::Open && !resume_pending()) {
+        drain_ingest();
+    }
+    if (replay_pending() && this->state == ClientState::Open) {
+        replay_step();
+    }
+    if (comms->connection_lost()) { // a send failed
+        connection_lost();
+    }
+    if (journal) {
+        journal->sync(); // MS_SYNC once per batch or JOURNAL_SYNC_MS, not per message
+    }
+    if constexpr (Transport::is_tcp) {
+        if (pacer) {
+            check_retransmits();
+        }
+    }
+}
+
+/**
+ * @brief TCP retransmissions slow the pacer down (-B), TCP_INFO is read at most
+ * once per PACER_HOLD_MS
+ */
+template <typename Transport>
+void Client_Session<Transport>::check_retransmits() requires (Transport::is_tcp)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - tcp.retransmits_checked < std::chrono::milliseconds(PACER_HOLD_MS)) return;
+    tcp.retransmits_checked = now;
+    uint32_t total = comms->tcp_retransmits();
+    if (total > tcp.retransmits) {
+        pacer->back_off(now);
+    }
+    tcp.retransmits = total;
+}
+
+/**
+ * @brief sends up to SHM_BATCH messages from the ring (-I), each straight from its slot,
+ * and publishes the result for the producer
+ */
+template <typename Transport>
+void Client_Session<Transport>::drain_ingest()
+{
+    std::string_view content;
+    for (size_t n = 0; n < SHM_BATCH && this->state == ClientState::Open && outbox.empty()
+                       && (!pacer || pacer->ready()) && ingest->peek(content); n++) {
+        arena.reset();
+        if (!check_message_content(content, MessageContent)) {
+            ingest->pop(Shm_Status::Invalid);
+            continue;
+        }
+        if (!send_chat_msg(content)) {
+            ingest->pop(Shm_Status::Failed);
+            graceful_exit(ERR_TIMEOUT);
+            return;
+        }
+        if (!outbox.empty()) {
+            ingest->pop(Shm_Status::Queued); // connection lost, resent first
+        } else if (confirmed_by_server()) {
+            ingest->pop(Shm_Status::Confirmed);
+        } else {
+            ingest->pop(Shm_Status::Sent); // TCP, or only queued for the network thread (-T)
+        }
+    }
+}
+
+template <typename Transport>
+void Client_Session<Transport>::handle_line(const std::string &line)
+{
+    if (line[0] == '/') { handle_command(line); } 
+    else {  handle_chat_msg(line); }
+}
+
+/**
+ * @brief stdout of the session, tagged with its name once there are more sessions,
+ * stderr once stdout carries records
+ */
+template <typename Transport>
+std::ostream& Client_Session<Transport>::out()
+{
+    std::ostream &os = config.get_output() == Output_Mode::Text ? std::cout : std::cerr;
+    if (!tag.empty()) {
+        os << '[' << tag << "] ";
+    } else if (hub && !hub->empty()) {
+        os << "[" HUB_MAIN "] ";
+    }
+    return os;
+}
+
+/**
+ * @brief a received message as the usual line, or as a record (-o). The server's
+ * bytes outside the printable range (escape sequences) are shown as \xNN.
+ */
+template <typename Transport>
+void Client_Session<Transport>::emit(Record_Type type, std::string_view sender, std::string_view content, int32_t msg_id)
+{
+    bool text = config.get_output() == Output_Mode::Text;
+    std::string_view shown_sender = sender, shown_content = content;
+    if (text || type == Record_Type::Msg) { // records escape or carry the raw bytes themselves
+        shown_sender = Toolkit::sanitize(sender, false, clean_sender);
+        shown_content = Toolkit::sanitize(content, true, clean_content);
+    }
+    if (type == Record_Type::Msg) {
+        record_message(shown_sender, shown_content); // /history and /search print it as text
+    }
+
+    if (text) {
+        switch (type) {
+            case Record_Type::Msg:       out() << shown_sender << ": " << shown_content << "\n"; break;
+            case Record_Type::Reply_Ok:  out() << "Action Success: " << shown_content << "\n"; break;
+            case Record_Type::Reply_Nok: out() << "Action Failure: " << shown_content << "\n"; break;
+            case Record_Type::Err:       out() << "ERROR FROM " << shown_sender << ": " << shown_content << "\n"; break;
+            case Record_Type::Bye:       out() << "ERROR FROM " << shown_sender << ": session ended\n"; break;
+        }
+        return;
+    }
+    int64_t stamp = comms->rx_timestamp(); // kernel timestamp with -L
+    if (stamp == 0) {
+        stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    std::string_view channel = restore.channel.empty() ? HISTORY_DEFAULT_CHANNEL : restore.channel;
+    output_writer.record(type, tag.empty() ? HUB_MAIN : tag, channel, sender, content, msg_id, stamp);
+}
+
+template <typename Transport>
+void Client_Session<Transport>::handle_chat_msg(const std::string &line) {
     printf_debug("sending MSG %s ...", line.c_str());
     
     if (this->state != ClientState::Open) {
-        std::cout << "ERROR: You must authenticate first. See '/help'.\n";
+        out() << "ERROR: You must authenticate first. See '/help'.\n";
         return;
     }
     if (!check_message_content(line, MessageContent)) {
-        std::cout << "ERROR: Invalid format of MessageContent, try again.\n";
+        out() << "ERROR: Invalid format of MessageContent, try again.\n";
         return;
     }
-    if (config.is_tcp()) {
-        // MSG FROM {DisplayName} IS {MessageContent}\r\n
-        std::string msg = "MSG FROM " + this->display_name + " IS " + line + "\r\n";
-        send_message(msg);    
-    } else {
-        uint16_t msg_id = comms->next_msg_id();
-        auto msg = Toolkit::build_msg(msg_id, this->display_name, line);
+    if (!send_chat_msg(line)) {
+        graceful_exit(ERR_TIMEOUT);
+        return;
+    }
+}
 
-        if (!send_with_retries(msg, msg_id)) {
-            graceful_exit(ERR_TIMEOUT);
-            return;
+template <typename Transport>
+bool Client_Session<Transport>::send_chat_msg(std::string_view line, uint64_t journal_id) {
+    if (pacer) {
+        pacer->take(); // callers wait for ready(), resends may go below zero
+    }
+    if (journal && journal_id == 0) {
+        journal_id = journal->append(line); // before it leaves the client
+    }
+    uint16_t msg_id = comms->next_msg_id();
+    auto msg = Transport::build_msg(msg_id, this->display_name, line, false, &arena);
+    if constexpr (Transport::is_tcp) {
+        if (config.get_reconnect()) {
+            tcp.sent_tail.push_back({std::string(line), msg.size()});
+            if (tcp.sent_tail.size() > RESEND_KEEP) tcp.sent_tail.pop_front();
         }
     }
+    if (deliver(msg, msg_id)) {
+        if (journal && !(net && net->running())) {
+            journal->delivered(journal_id); // UDP confirmed, TCP handed to the kernel
+        } else if constexpr (Transport::needs_confirm) {
+            if (journal) {
+                udp.journal_ids[msg_id] = journal_id; // only queued, see confirmed()
+            }
+        }
+        record_message(this->display_name, line);
+        return true;
+    }
+    if (config.get_reconnect() && !reconnecting) {
+        outbox.push_front({std::string(line), journal_id}); // not confirmed, first to go once reconnected
+        return reconnect();
+    }
+    return false;
 }
 
-void Client_Session::handle_command(const std::string &line) {
+template <typename Transport>
+void Client_Session<Transport>::handle_command(const std::string &line) {
     printf_debug("%s", line.c_str());
 
-    std::istringstream iss(line);
-    std::string command;
-    std::vector<std::string> args;
-    std::string temp;
-
-    iss >> command; // first value is command
-    while (iss >> temp) {
-        args.push_back(temp); // the rest are arguments
+    // split on whitespace like operator>>, views into line
+    std::pmr::vector<std::string_view> words(&arena);
+    std::string_view rest = line;
+    while (true) {
+        size_t begin = rest.find_first_not_of(" \t\r\n\v\f");
+        if (begin == std::string_view::npos) break;
+        rest.remove_prefix(begin);
+        size_t end = std::min(rest.find_first_of(" \t\r\n\v\f"), rest.size());
+        words.push_back(rest.substr(0, end));
+        rest.remove_prefix(end);
     }
+    if (words.empty()) return;
+
+    std::string_view command = words[0]; // first value is command
+    Args args = Args(words).subspan(1);  // the rest are arguments
 
     if (command == "/auth") {
         send_auth(args);
@@ -152,140 +602,223 @@ void Client_Session::handle_command(const std::string &line) {
         send_join(args);
     } else if (command == "/rename") {
         rename(args);
+    } else if (command == "/history") {
+        show_history(args);
+    } else if (command == "/search") {
+        search_messages(args);
+    } else if (command == "/open" || command == "/switch") {
+        if (!hub) { // sessions opened by /open have none
+            out() << "ERROR: " << command << " is handled by the main session only.\n";
+        } else if (command == "/open") {
+            hub->open(args);
+        } else {
+            hub->switch_to(args);
+        }
     } else if (command == "/help") {
         print_local_help();
     } else {
-        std::cout << "ERROR: Invalid command. Get some '/help'.\n";
+        out() << "ERROR: Invalid command. Get some '/help'.\n";
     }
 }
 
-void Client_Session::send_auth(const std::vector<std::string>& args) 
+template <typename Transport>
+void Client_Session<Transport>::send_auth(Args args) 
 {
     if (this->state != ClientState::Start) {
-        std::cout << "ERROR: Cannot authenticate again.\n";
+        out() << "ERROR: Cannot authenticate again.\n";
         return;
     }
     if (args.size() != 3) { // /auth {Username} {Secret} {DisplayName}
-        std::cout << "ERROR: Missing arguments, try again.\n";
+        out() << "ERROR: Missing arguments, try again.\n";
         return;
     }
 
-    this->state = ClientState::Auth;
-    auto username = args.at(0);
-    auto secret = args.at(1);
-    rename(std::vector<std::string>{args[2]});
+    set_state(ClientState::Auth);
+    auto username = args[0];
+    auto secret = args[1];
+    rename(args.subspan(2));
 
     if (!check_message_content(username, Username) 
         || !check_message_content(secret, Secret)) {
-        std::cout << "ERROR: Invalid Username/Secret format.\n";
-        this->state = ClientState::Open;
+        out() << "ERROR: Invalid Username/Secret format.\n";
+        set_state(ClientState::Open);
         return;
     }
 
-    std::optional<std::string> tcp_reply;
-    std::optional<std::vector<uint8_t>> udp_reply;
+    restore.username = username;
+    restore.secret = secret;
 
-    if (config.is_tcp()) {
-        auto auth_msg = "AUTH " + username + " AS " + this->display_name 
-                        + " USING " + secret + "\r\n"; 
-        send_message(auth_msg); 
-        tcp_reply = comms->timed_tcp_reply(); 
-        
+    auto msg_id = comms->next_msg_id();
+    auto auth_msg = Transport::build_auth(msg_id, username, this->display_name, secret, &arena);
+
+    auto sent = std::chrono::system_clock::now();
+    if (!deliver(auth_msg, msg_id)) {
+        if (!reconnect()) graceful_exit(ERR_TIMEOUT); // AUTH is replayed
+        return;
+    }
+    if constexpr (Transport::is_tcp) {
+        std::optional<std::pmr::string> tcp_reply = comms->timed_tcp_reply(timers.expiry(reply_timer), &arena); 
         if (!tcp_reply) {
-            std::cout << "ERROR: Authentication timed out.\n";
+            if (comms->connection_lost()) {
+                connection_lost();
+                return;
+            }
+            out() << "ERROR: Authentication timed out.\n";
             graceful_exit();
             return;
         }
-        std::string tcp_confirmation = *tcp_reply;
-        handle_tcp_response(tcp_confirmation);
-    } else {
-        auto msg_id = comms->next_msg_id();
-        auto auth_msg = Toolkit::build_auth(msg_id, username, 
-                                            this->display_name, secret);
-        
-        if (!send_with_retries(auth_msg, msg_id)) {
-            graceful_exit(ERR_TIMEOUT);
-            return;
-        }
+        add_latency(sent);
+        handle_tcp_response(*tcp_reply);
     }
 }
 
-void Client_Session::send_join(const std::vector<std::string>& args) 
+template <typename Transport>
+void Client_Session<Transport>::send_join(Args args) 
 {
     if (this->state != ClientState::Open) 
     {
-        std::cout << "ERROR: To join a channel, you first must authenticate.\n";
+        out() << "ERROR: To join a channel, you first must authenticate.\n";
         return;
     }
 
     if (args.size() != 1) 
     {   // /join {ChannelID}
-        std::cout << "ERROR: No ChannelID, try again.\n";
+        out() << "ERROR: No ChannelID, try again.\n";
         return;
     }
 
-    this->state = ClientState::Join;
-
-    auto channel_id = args.at(0);
-    if (check_message_content(channel_id, ChannelID)) 
+    auto channel_id = args[0];
+    if (!check_message_content(channel_id, ChannelID)) 
     {   // JOIN {ChannelID} AS {DisplayName}\r\n
-        std::cout << "ERROR: Invalid ChannelID format, try again.\n";
+        out() << "ERROR: Invalid ChannelID format, try again.\n";
         return;
     }
+    join_channel(channel_id);
+}
+
+template <typename Transport>
+void Client_Session<Transport>::join_channel(std::string_view channel_id) 
+{
+    set_state(ClientState::Join);
+    restore.joining = channel_id;
  
-    std::optional<std::string> tcp_reply;
+    auto msg_id = comms->next_msg_id();
+    auto join_msg = Transport::build_join(msg_id, channel_id, this->display_name, &arena);
 
-    if (config.is_tcp()) 
-    {
-        auto join_msg = "JOIN " + args.at(0) + " AS " + this->display_name + "\r\n"; 
-        send_message(join_msg);
-        
-        tcp_reply = comms->timed_tcp_reply();
+    auto sent = std::chrono::system_clock::now();
+    if (!deliver(join_msg, msg_id)) {
+        if (!reconnect()) graceful_exit(ERR_TIMEOUT); // JOIN is replayed
+        return;
+    }
+    if constexpr (Transport::is_tcp) {
+        std::optional<std::pmr::string> tcp_reply = comms->timed_tcp_reply(timers.expiry(reply_timer), &arena);
         if (!tcp_reply) {
-            std::cout << "ERROR: Authentication timed out.\n";
+            if (comms->connection_lost()) {
+                connection_lost();
+                return;
+            }
+            out() << "ERROR: Authentication timed out.\n";
             graceful_exit();
             return;
         }
-        std::string tcp_confirmation = *tcp_reply;
-        handle_tcp_response(tcp_confirmation);
-    } else {
-        auto msg_id = comms->next_msg_id();
-        auto join_msg = Toolkit::build_join(msg_id, channel_id, this->display_name);
-        
-        if (!send_with_retries(join_msg, msg_id)) {
-            graceful_exit(ERR_TIMEOUT);
-            return;
-        }     
+        add_latency(sent);
+        handle_tcp_response(*tcp_reply);
     }
 }
 
-void Client_Session::rename(const std::vector<std::string>& args) 
+template <typename Transport>
+void Client_Session<Transport>::rename(Args args) 
 {
     if ( !(args.size() == 1)) 
     {   // /rename {DisplayName}
-        std::cout << "ERROR: No or multiple usernames selected, try again.\n";
+        out() << "ERROR: No or multiple usernames selected, try again.\n";
         return;
     }
-    if (check_message_content(args.at(0), DisplayName)) 
+    if (check_message_content(args[0], DisplayName)) 
     {
-        this->display_name = args.at(0);
+        this->display_name = args[0];
         printf_debug("Changed DisplayName to '%s'", this->display_name.c_str()); 
     } else {
-        std::cout << "ERROR: Invalid DisplayName format, try again.\n";
+        out() << "ERROR: Invalid DisplayName format, try again.\n";
     }
 }
 
-bool Client_Session::check_message_content(const std::string &content, msg_param param) 
+template <typename Transport>
+void Client_Session<Transport>::show_history(Args args) 
+{
+    if (!history) {
+        out() << "ERROR: History is not kept, start the client with '-H <dir>'.\n";
+        return;
+    }
+    size_t count = HISTORY_DEFAULT_LINES;
+    if (args.size() > 1) 
+    {   // /history [count]
+        out() << "ERROR: Too many arguments, try again.\n";
+        return;
+    }
+    if (args.size() == 1) {
+        auto [end, ec] = std::from_chars(args[0].data(), args[0].data() + args[0].size(), count);
+        if (ec != std::errc() || end != args[0].data() + args[0].size()) {
+            out() << "ERROR: Invalid count, try again.\n";
+            return;
+        }
+    }
+    bool text = config.get_output() == Output_Mode::Text;
+    (text ? std::cout : std::cerr).flush(); // lines are written to the descriptor directly
+    history->print_last(count, text ? STDOUT_FILENO : STDERR_FILENO);
+}
+
+template <typename Transport>
+void Client_Session<Transport>::search_messages(Args args) 
+{
+    if (!search) {
+        out() << "ERROR: Messages are not indexed, start the client with '-S'.\n";
+        return;
+    }
+    if (args.empty()) 
+    {   // /search {words} [from:{name}]
+        out() << "ERROR: Nothing to search for, try again.\n";
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = search->search(args, SEARCH_MAX_RESULTS);
+    auto took = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (uint32_t doc : result.newest) {
+        out() << search->name(doc) << ": " << search->content(doc) << "\n";
+    }
+    std::cerr << result.total << " of " << search->size() << " messages match, "
+              << took << " ms\n";
+}
+
+template <typename Transport>
+void Client_Session<Transport>::record_message(std::string_view name, std::string_view content) 
+{
+    if (history) history->append(name, content);
+    if (search) search->add(name, content);
+}
+
+template <typename Transport>
+void Client_Session<Transport>::channel_joined() 
+{
+    restore.channel = restore.joining;
+    if (history) {
+        history->open_channel(restore.channel);
+    }
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::check_message_content(std::string_view content, msg_param param) 
 {
     switch (param)
     {
     case Username:
     case ChannelID:
-        return content.size() <= 20 && Toolkit::only_allowed_chars(content, "^[a-zA-Z0-9_-]+$");
+        return content.size() <= 20 && Toolkit::only_allowed_chars(content);
         break;
     
     case Secret:
-        return content.size() <= 128 && Toolkit::only_allowed_chars(content, "^[a-zA-Z0-9_-]+$");
+        return content.size() <= 128 && Toolkit::only_allowed_chars(content);
         break;
 
     case DisplayName:
@@ -302,23 +835,62 @@ bool Client_Session::check_message_content(const std::string &content, msg_param
     }
 }
 
-void Client_Session::send_message(const std::string& msg) {
-    printf_debug("About to send %s", msg.c_str());
+template <typename Transport>
+void Client_Session<Transport>::send_message(std::string_view msg) {
+    printf_debug("About to send %.*s", (int)msg.size(), msg.data());
     comms->send_tcp_message(msg);
 }
-void Client_Session::send_message(const std::vector<uint8_t>& msg) {
+template <typename Transport>
+void Client_Session<Transport>::send_message(std::span<const uint8_t> msg) {
     printf_debug("About to send UDP message");
+    if (net && net->running()) {
+        net->send(std::vector<uint8_t>(msg.begin(), msg.end())); // leaves the arena
+        return;
+    }
     comms->send_udp_message(msg);
 }
 
-bool Client_Session::send_with_retries(const std::vector<uint8_t>& msg, uint16_t msg_id) {
+/**
+ * @brief reliability hook, returns false if the message could not be delivered
+ */
+template <typename Transport>
+bool Client_Session<Transport>::deliver(const Packet& msg, uint16_t msg_id) {
+    if constexpr (Transport::needs_confirm) {
+        return send_with_retries(msg, msg_id);
+    } else {
+        send_message(msg);
+        return true;
+    }
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::send_with_retries(std::span<const uint8_t> msg, uint16_t msg_id) requires (Transport::needs_confirm) {
+    udp.confirmed_id.reset();
+    if (net && net->running()) {
+        // network thread retransmits, giving up is reported by Net_Event::GaveUp
+        net->send(std::vector<uint8_t>(msg.begin(), msg.end()));
+        return true;
+    }
     for (int i = 0; i < config.get_retries(); ++i) {
+        if (i > 0 && pacer) {
+            pacer->back_off(); // the server or the path is overloaded
+        }
+        auto sent = std::chrono::system_clock::now();
         comms->send_udp_message(msg);
 
-        auto reply = comms->timed_udp_reply();
-        if (reply.has_value()) {
+        // other messages received meanwhile are handled, only our CONFIRM ends the wait
+        auto retransmit = timers.schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(config.get_timeout()));
+        while (auto reply = udp_reply_before(retransmit)) {
+            bool ours = Udp_Transport::get_type(*reply) == 0x00 && Udp_Transport::get_msg_id(*reply) == msg_id;
+            if (ours && i == 0) {
+                add_latency(sent); // retransmitted ones are ambiguous
+            }
             handle_udp_response(*reply);
-            return true;
+            if (ours) {
+                timers.cancel(retransmit);
+                udp.confirmed_id = msg_id;
+                return true;
+            }
         }
         printf_debug("Retry %d for msg_id %d", i + 1, msg_id);
     }
@@ -327,6 +899,355 @@ bool Client_Session::send_with_retries(const std::vector<uint8_t>& msg, uint16_t
     return false;
 }
 
+/**
+ * @brief the last chat message got its CONFIRM, not only handed to the network thread
+ */
+template <typename Transport>
+bool Client_Session<Transport>::confirmed_by_server() const
+{
+    if constexpr (Transport::needs_confirm) {
+        return udp.confirmed_id.has_value();
+    } else {
+        return false;
+    }
+}
+
+/**
+ * @brief waits for a datagram until the timer fires, timers expiring before it
+ * (e.g. the reorder buffer) are run meanwhile
+ */
+template <typename Transport>
+std::optional<Toolkit::Bytes> Client_Session<Transport>::udp_reply_before(Timer_Wheel::Id timer) requires (Transport::needs_confirm) 
+{
+    while (timers.pending(timer)) {
+        auto reply = comms->timed_udp_reply(*timers.next_expiry(), &arena);
+        timers.advance(std::chrono::steady_clock::now());
+        if (reply) return reply;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief round trip of a request, split by kernel timestamps when available
+ */
+template <typename Transport>
+void Client_Session<Transport>::add_latency(std::chrono::system_clock::time_point sent) 
+{
+    if (!config.print_latency()) return; // nothing is reserved, nothing is printed
+    auto done = std::chrono::system_clock::now();
+    auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(done - sent);
+    rtt.add(total);
+
+    int64_t rx = comms->rx_timestamp();
+    if (rx == 0) return;
+    int64_t tx = comms->tx_timestamp();
+    int64_t sent_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(sent.time_since_epoch()).count();
+    if (tx < sent_ns) {
+        tx = sent_ns; // no TX timestamp, the send is counted as network time
+    }
+    auto network = std::chrono::nanoseconds(rx - tx);
+    rtt_network.add(network);
+    rtt_client.add(total - network);
+}
+
+/**
+ * @brief reconnects with exponential backoff (-A) and authenticates again with
+ * the kept credentials, JOIN and unconfirmed messages follow in resume_session()
+ */
+template <typename Transport>
+bool Client_Session<Transport>::reconnect() 
+{
+    if (!config.get_reconnect() || reconnecting || net) return false;
+    reconnecting = true;
+    std::cerr << "Connection to the server lost, reconnecting...\n";
+
+    if constexpr (Transport::is_tcp) {
+        // messages whose bytes the server's kernel never acknowledged go again, at least once
+        size_t unacked = comms->unacked_bytes();
+        auto it = tcp.sent_tail.end();
+        while (unacked > 0 && it != tcp.sent_tail.begin()) {
+            --it;
+            unacked -= std::min(unacked, it->bytes);
+        }
+        for (; it != tcp.sent_tail.end(); ++it) {
+            outbox.push_back({std::move(it->content), 0});
+        }
+        tcp.sent_tail.clear();
+    }
+    if (this->state == ClientState::Join) {
+        restore.channel = restore.joining; // replayed as well
+    }
+    restore.rejoin = !restore.channel.empty();
+
+    auto start = std::chrono::steady_clock::now();
+    auto backoff = std::chrono::milliseconds(RECONNECT_BACKOFF_MIN);
+    bool connected = false;
+    for (int attempt = 1; attempt <= config.get_reconnect() && !stop_requested; ++attempt) {
+        if (comms->reconnect() && replay_auth()) {
+            connected = true;
+            break;
+        }
+        printf_debug("Reconnect attempt %d failed", attempt);
+        if (attempt < config.get_reconnect()) {
+            std::this_thread::sleep_for(backoff);
+        }
+        backoff = std::min(backoff * 2, std::chrono::milliseconds(RECONNECT_BACKOFF_MAX));
+    }
+    reconnecting = false;
+
+    if (!connected) {
+        std::cerr << "ERROR: Cannot reconnect to the server.\n";
+        return false;
+    }
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Reconnected in " << took << " ms\n";
+    return true;
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::replay_auth() 
+{
+    if constexpr (Transport::needs_confirm) {
+        udp.processed_ids.reset(); // the server starts its msg_ids again
+        if (udp.reorder) {
+            udp.reorder = std::make_unique<Reorder_Buffer>(std::chrono::milliseconds(config.get_reorder_wait()));
+        }
+    }
+    if (restore.username.empty()) { // never authenticated
+        set_state(ClientState::Start);
+        return true;
+    }
+
+    set_state(ClientState::Auth);
+    auto msg_id = comms->next_msg_id();
+    auto auth_msg = Transport::build_auth(msg_id, restore.username, this->display_name, restore.secret, &arena);
+    if (!deliver(auth_msg, msg_id)) {
+        return false; // UDP, not confirmed
+    }
+    if constexpr (Transport::is_tcp) {
+        std::optional<std::pmr::string> tcp_reply = comms->timed_tcp_reply(timers.expiry(reply_timer), &arena);
+        if (!tcp_reply) {
+            return false;
+        }
+        handle_tcp_response(*tcp_reply);
+    }
+    return !comms->connection_lost();
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::resume_session() 
+{
+    if (this->state != ClientState::Open) return false;
+
+    if (restore.rejoin) {
+        restore.rejoin = false;
+        join_channel(restore.channel);
+        return true;
+    }
+    while (!outbox.empty() && this->state == ClientState::Open) {
+        Outgoing next = std::move(outbox.front());
+        outbox.pop_front();
+        if (!send_chat_msg(next.content, next.journal_id)) {
+            graceful_exit(ERR_TIMEOUT);
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief opens the journal (-J), messages left undelivered by an earlier run
+ * are sent in bulk once authenticated, before new lines from stdin
+ */
+template <typename Transport>
+void Client_Session<Transport>::open_journal() 
+{
+    this->journal = std::make_unique<Outbox_Journal>(config.get_journal(), comms->is_hosted());
+    for (auto &entry : journal->recovered()) {
+        outbox.push_back({std::move(entry.content), entry.id});
+    }
+    if (!outbox.empty()) {
+        std::cerr << outbox.size() << " undelivered messages in " << config.get_journal()
+                  << " will be sent after authentication\n";
+    }
+}
+
+template <typename Transport>
+void Client_Session<Transport>::connection_lost() 
+{
+    if (reconnect()) return;
+    out() << "ERROR: Server has closed the connection.\n";
+    comms->terminate_connection(ERR_SERVER);
+}
+
+/**
+ * @brief maps the file given with -f and validates all of its lines up front,
+ * so the send loop only builds and sends messages
+ */
+template <typename Transport>
+void Client_Session<Transport>::load_corpus() 
+{
+    this->corpus = std::make_unique<Corpus>(config.get_corpus());
+
+    for (auto line : corpus->get_lines()) {
+        if (line.empty()) continue; // same as empty lines from stdin
+
+        if (check_message_content(line, MessageContent)) {
+            replay_queue.push_back(line);
+        } else {
+            replay.invalid++;
+        }
+    }
+    if (replay.invalid > 0) {
+        std::cerr << "WARNING: " << replay.invalid << " invalid lines in "
+                  << config.get_corpus() << " will be skipped.\n";
+    }
+    printf_debug("%zu messages ready to be sent", replay_queue.size());
+}
+
+template <typename Transport>
+bool Client_Session<Transport>::replay_pending() const {
+    return replay.next < replay_queue.size();
+}
+
+template <typename Transport>
+void Client_Session<Transport>::replay_step() 
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!replay.started) {
+        replay.started = true;
+        replay.start = now;
+        replay.next_send = now;
+    }
+
+    auto pacing = std::chrono::microseconds(config.get_pacing());
+    size_t batch = config.get_pacing() ? 1 : REPLAY_BATCH; // return to select() in between
+
+    while (batch-- > 0 && replay_pending() && now >= replay.next_send && (!pacer || pacer->ready(now))) {
+        std::string_view line = replay_queue[replay.next++];
+        arena.reset();
+
+        if (!send_chat_msg(line)) {
+            replay.failed++;
+            print_replay_summary();
+            graceful_exit(ERR_TIMEOUT);
+            return;
+        }
+        replay.sent++;
+        replay.bytes += line.size();
+        replay.next_send += pacing;
+    }
+
+    if (!replay_pending()) {
+        print_replay_summary();
+    }
+}
+
+template <typename Transport>
+void Client_Session<Transport>::print_replay_summary() 
+{
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - replay.start).count();
+    double rate = elapsed > 0 ? replay.sent / elapsed : 0;
+    double mbps = elapsed > 0 ? replay.bytes / elapsed / 1e6 : 0;
+
+    std::cerr << "Sent " << replay.sent << "/" << replay_queue.size() + replay.invalid 
+              << " messages from " << config.get_corpus() << " ("
+              << replay.invalid << " invalid, " << replay.failed << " failed), "
+              << replay.bytes << " bytes in " << elapsed << " s, "
+              << rate << " msg/s, " << mbps << " MB/s\n";
+}
+
+/**
+ * @brief replays a capture (-C) as fast as possible, sent messages only move
+ * the state like they did, received ones go through the same handlers as from
+ * the socket, whose sends are dropped
+ */
+template <typename Transport>
+void Client_Session<Transport>::replay_capture() 
+{
+    comms->enable_offline();
+    Pcap_Reader reader(config.get_replay(), Transport::is_tcp);
+    set_state(ClientState::Start);
+
+    capture_stats.active = true;
+    capture_stats.start = std::chrono::steady_clock::now();
+
+    for (const Pcap_Frame &frame : reader.get_frames()) {
+        arena.reset();
+        if (!frame.inbound) {
+            track_outbound(frame.payload);
+            continue;
+        }
+        capture_stats.bytes += frame.payload.size();
+
+        if constexpr (Transport::is_tcp) {
+            comms->buffer.append(frame.payload.begin(), frame.payload.end());
+            while (true) {
+                size_t pos = comms->buffer.find("\r\n");
+                if (pos == std::string::npos) break;
+
+                arena.reset();
+                std::pmr::string msg(comms->buffer.data(), pos, &arena);
+                comms->buffer.erase(0, pos + 2);
+                capture_stats.messages++;
+                handle_tcp_response(msg);
+            }
+        } else {
+            capture_stats.messages++;
+            handle_udp_response(frame.payload);
+        }
+        if (stop_requested) break;
+    }
+    graceful_exit();
+}
+
+template <typename Transport>
+void Client_Session<Transport>::track_outbound(std::span<const uint8_t> payload) 
+{
+    if constexpr (Transport::is_tcp) {
+        std::istringstream iss(std::string(payload.begin(), payload.end()));
+        std::string line;
+        while (std::getline(iss, line)) {
+            std::istringstream words(line);
+            std::string type, arg, as, name;
+            words >> type >> arg >> as >> name;
+            if (type == "AUTH") {
+                set_state(ClientState::Auth);
+                this->display_name = name; // AUTH {Username} AS {DisplayName} USING {Secret}
+            } else if (type == "JOIN") {
+                set_state(ClientState::Join);
+            }
+        }
+    } else {
+        if (payload.empty()) return;
+        if (payload[0] == 0x02) {
+            set_state(ClientState::Auth);
+            // msg_id, Username\0, DisplayName\0, Secret\0
+            auto user_end = std::find(payload.begin() + std::min<size_t>(3, payload.size()), payload.end(), 0);
+            if (user_end != payload.end()) {
+                this->display_name.assign(user_end + 1, std::find(user_end + 1, payload.end(), 0));
+            }
+        } else if (payload[0] == 0x03) {
+            set_state(ClientState::Join);
+        }
+    }
+}
+
+template <typename Transport>
+void Client_Session<Transport>::print_capture_summary() 
+{
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - capture_stats.start).count();
+    double rate = elapsed > 0 ? capture_stats.messages / elapsed : 0;
+    double mbps = elapsed > 0 ? capture_stats.bytes / elapsed / 1e6 : 0;
+
+    std::cerr << "Replayed " << capture_stats.messages << " messages from " << config.get_replay()
+              << ", " << capture_stats.bytes << " bytes in " << elapsed << " s, "
+              << rate << " msg/s, " << mbps << " MB/s\n";
+}
+
 /**
  *   MMMMMMM   OOOO  HHHH
  *      H     O      H   H
@@ -335,12 +1256,12 @@ bool Client_Session::send_with_retries(const std::vector<uint8_t>& msg, uint16_t
  *      H      OOOO  H
 */
 
-void Client_Session::handle_tcp_response(std::string &msg) {
-    auto parsed_opt = parse_tcp_message(msg);
+template <typename Transport>
+void Client_Session<Transport>::handle_tcp_response(std::string_view msg) requires (Transport::is_tcp) {
+    auto parsed_opt = Tcp_Transport::parse(msg);
     if (!parsed_opt) {
-        std::cout << "ERROR: Malformed message received: " << msg << "\n";
-        std::string err = "ERR FROM " + this->display_name + " IS invalid message\r\n";
-        send_message(err);
+        out() << "ERROR: Malformed message received: " << msg << "\n";
+        send_message(Transport::build_msg(0, this->display_name, "invalid message", true, &arena));
         graceful_exit();
         return;
     }
@@ -349,101 +1270,148 @@ void Client_Session::handle_tcp_response(std::string &msg) {
     switch (this->state) {
         case ClientState::Auth:
             if (parsed.type == "REPLY OK") {
-                std::cout << "Action Success: " << parsed.content << "\n";
-                this->state = ClientState::Open;
+                emit(Record_Type::Reply_Ok, "", parsed.content);
+                set_state(ClientState::Open);
             } else if (parsed.type == "REPLY NOK") {
-                std::cout << "Action Failure: " << parsed.content << "\n";
-                this->state = ClientState::Start;
+                emit(Record_Type::Reply_Nok, "", parsed.content);
+                set_state(ClientState::Start);
             } else if (parsed.type == "ERR") {
-                std::cout << "ERROR FROM " << parsed.display_name << ": " << parsed.content << "\n";
+                emit(Record_Type::Err, parsed.display_name, parsed.content);
                 graceful_exit(ERR_SERVER);
             } else {
-                std::cout << "ERROR: Unexpected message in AUTH state: " << msg << "\n";
+                out() << "ERROR: Unexpected message in AUTH state: " << msg << "\n";
+                flight_recorder.event("MALFORMED"); // dumped by the exit with an error
                 graceful_exit(ERR_SERVER);
             }
             break;
 
         case ClientState::Open:
             if (parsed.type == "REPLY OK" || parsed.type == "REPLY NOK") {
-                std::cout << "ERROR: Unexpected REPLY received: " << parsed.content << "\n";
+                out() << "ERROR: Unexpected REPLY received: " << parsed.content << "\n";
                 graceful_exit(ERR_SERVER);
             }
             // fall through is desired here - REPLY (N)OK is either handled or the rest is similar.
+            [[fallthrough]];
         case ClientState::Join:
             if (parsed.type == "MSG") {
-                std::cout << parsed.display_name << ": " << parsed.content << "\n";
+                emit(Record_Type::Msg, parsed.display_name, parsed.content);
             } else if (parsed.type == "REPLY OK" || parsed.type == "REPLY NOK") {
-                std::cout << (parsed.type == "REPLY OK" ? "Action Success: " : "Action Failure: ") << parsed.content << "\n";
-                this->state = ClientState::Open;
+                emit(parsed.type == "REPLY OK" ? Record_Type::Reply_Ok : Record_Type::Reply_Nok, "", parsed.content);
+                if (parsed.type == "REPLY OK") {
+                    channel_joined();
+                }
+                set_state(ClientState::Open);
 
             } else if (parsed.type == "ERR") {
-                std::cout << "ERROR FROM " << parsed.display_name << ": " << parsed.content << "\n";
+                emit(Record_Type::Err, parsed.display_name, parsed.content);
                 graceful_exit(ERR_SERVER);
             } else if (parsed.type == "BYE") {
-                std::cout << "ERROR FROM " << parsed.display_name << ": session ended\n";
+                emit(Record_Type::Bye, parsed.display_name, "");
                 graceful_exit(ERR_SERVER);
             } else {
-                std::cout << "ERROR: Unexpected message received: " << msg << "\n";
-                std::string err = "ERR FROM " + this->display_name + " IS invalid message\r\n";
-                send_message(err);
+                out() << "ERROR: Unexpected message received: " << msg << "\n";
+                flight_recorder.event("MALFORMED"); // dumped by the exit with an error
+                send_message(Transport::build_msg(0, this->display_name, "invalid message", true, &arena));
                 graceful_exit(ERR_SERVER);
             }
             break;
 
         case ClientState::Start:
         default:
-            std::cout << "ERROR: Message received in invalid client state: " << msg << "\n";
+            out() << "ERROR: Message received in invalid client state: " << msg << "\n";
             break;
     }
 }
 
-std::optional<Client_Session::ParsedMessage> Client_Session::parse_tcp_message(const std::string &msg) 
-{
-    printf_debug("Parsing message: %s", msg.c_str());
-
-    ParsedMessage result;
+/**
+  *   H    H  HOOOO   HHHO
+  *   H    H  H    O  H   H
+  *   H    H  H    O  HHHHO
+  *   O    O  H    O  H
+  *    OOOO   HOOOO   H
+*/
 
-    if (msg.starts_with("REPLY OK IS ") || msg.starts_with("REPLY NOK IS ")) {
-        bool is_ok = msg.starts_with("REPLY OK IS ");
-        result.type = is_ok ? "REPLY OK" : "REPLY NOK";
-        size_t prefix_len = is_ok ? strlen("REPLY OK IS ") : strlen("REPLY NOK IS ");
-        result.content = msg.substr(prefix_len);
+template <typename Transport>
+void Client_Session<Transport>::confirm(uint16_t msg_id) requires (Transport::needs_confirm) {
+    if (net && net->running()) return; // already confirmed by the network thread
+    if (udp.suppress_confirm) return;      // released by the reorder buffer, confirmed on arrival
+    comms->send_udp_message(Toolkit::build_confirm(msg_id, &arena));
+}
 
-    } else if (msg.starts_with("MSG FROM ")) {
-        result.type = "MSG";
-        size_t from_pos = strlen("MSG FROM ");
-        size_t is_pos = msg.find(" IS ", from_pos);
-        if (is_pos != std::string::npos) {
-            result.display_name = msg.substr(from_pos, is_pos - from_pos);
-            result.content = msg.substr(is_pos + 4);
-        }
+template <typename Transport>
+int Client_Session<Transport>::event_fd() {
+    return (net && net->running()) ? net->get_event_fd() : comms->get_socket();
+}
 
-    } else if (msg.starts_with("ERR FROM ")) {
-        result.type = "ERR";
-        size_t from_pos = strlen("ERR FROM ");
-        size_t is_pos = msg.find(" IS ", from_pos);
-        if (is_pos != std::string::npos) {
-            result.display_name = msg.substr(from_pos, is_pos - from_pos);
-            result.content = msg.substr(is_pos + 4);
-        }
+template <typename Transport>
+std::chrono::steady_clock::time_point Client_Session<Transport>::heard_at() const requires (Transport::needs_confirm)
+{
+    if (net && net->running()) {
+        return std::max(udp.last_heard, net->last_heard());
+    }
+    return udp.last_heard;
+}
 
-    } else if (msg.starts_with("BYE FROM ")) {
-        result.type = "BYE";
-        result.display_name = msg.substr(strlen("BYE FROM "));
+/**
+ * @brief -K over UDP, the server PINGs idle clients, so a server that hasn't sent
+ * anything for that long is gone. Reconnects with -A, exits otherwise.
+ */
+template <typename Transport>
+void Client_Session<Transport>::check_liveness() requires (Transport::needs_confirm)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - heard_at() < std::chrono::seconds(config.get_keepalive())) return;
+
+    flight_recorder.event("PEER SILENT");
+    udp.last_heard = now; // a reconnected session gets the whole time again
+    if (reconnect()) return;
+    out() << "ERROR: Nothing received from the server for " << config.get_keepalive() << " s.\n";
+    if (net && net->running()) {
+        net->stop();
     }
+    comms->terminate_connection(ERR_SERVER);
+}
 
-    return result;
+template <typename Transport>
+void Client_Session<Transport>::handle_net_events() requires (Transport::needs_confirm) 
+{
+    net->clear_event_fd(); // before draining, so no event is missed
+    Net_Event ev;
+    while (net->next_event(ev)) {
+        if (ev.type == Net_Event::Type::Retried) {
+            if (pacer) pacer->back_off();
+            continue;
+        }
+        if (ev.type == Net_Event::Type::Confirmed) {
+            confirmed(ev.msg_id);
+            continue;
+        }
+        if (ev.type == Net_Event::Type::GaveUp) {
+            std::cerr << "ERROR: No reply for msg_id " << ev.msg_id << ", giving up.\n";
+            graceful_exit(ERR_TIMEOUT);
+            return;
+        }
+        handle_udp_response(ev.data);
+    }
 }
 
 /**
-  *   H    H  HOOOO   HHHO
-  *   H    H  H    O  H   H
-  *   H    H  H    O  HHHHO
-  *   O    O  H    O  H
-  *    OOOO   HOOOO   H
-*/
+ * @brief CONFIRM of a message the network thread (-T) sent, its journal record is delivered
+ */
+template <typename Transport>
+void Client_Session<Transport>::confirmed(uint16_t msg_id) requires (Transport::needs_confirm)
+{
+    auto it = udp.journal_ids.find(msg_id);
+    if (it == udp.journal_ids.end()) return;
+    journal->delivered(it->second);
+    udp.journal_ids.erase(it);
+}
 
-void Client_Session::handle_udp_response(const std::vector<uint8_t>& pac) {
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_response(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
+    if (config.get_keepalive()) {
+        udp.last_heard = std::chrono::steady_clock::now();
+    }
     if (pac.size() < 3) {
         std::cerr << "ERROR: Empty or malformed UDP packet received\n";
         return;
@@ -452,12 +1420,41 @@ void Client_Session::handle_udp_response(const std::vector<uint8_t>& pac) {
     uint8_t type = pac[0];
     uint16_t msg_id = (pac[1] << 8) | pac[2];
 
-    if (this->processed_ids.contains(msg_id)) {
-        comms->send_udp_message(Toolkit::build_confirm(msg_id));
+    if (udp.processed_ids.test(msg_id)) {
+        confirm(msg_id);
         printf_debug("Received duplicate msg_id: %d. Resent confirm", msg_id);
         return;
     }
 
+    if (udp.reorder && type != 0x00) {
+        confirm(msg_id); // right away, handlers of released messages don't confirm again
+        udp.processed_ids.set(msg_id);
+        std::vector<std::vector<uint8_t>> ready;
+        udp.reorder->push(msg_id, pac, ready);
+        dispatch_reordered(ready);
+        return;
+    }
+    dispatch_udp(pac);
+    if (type != 0x00) { // CONFIRM refers to our msg_id
+        udp.processed_ids.set(msg_id);
+    }
+}
+
+template <typename Transport>
+void Client_Session<Transport>::dispatch_reordered(std::vector<std::vector<uint8_t>>& ready) requires (Transport::needs_confirm) 
+{
+    udp.suppress_confirm = true;
+    for (auto &pac : ready) {
+        dispatch_udp(pac);
+    }
+    udp.suppress_confirm = false;
+}
+
+template <typename Transport>
+void Client_Session<Transport>::dispatch_udp(std::span<const uint8_t> pac) requires (Transport::needs_confirm) 
+{
+    uint8_t type = pac[0];
+    uint16_t msg_id = (pac[1] << 8) | pac[2];
 
     switch (type) {
         case 0x00: return handle_udp_confirm(pac);
@@ -468,107 +1465,99 @@ void Client_Session::handle_udp_response(const std::vector<uint8_t>& pac) {
         case 0xFE: handle_udp_err(pac); break;
         case 0xFF: handle_udp_bye(pac); break;
         default:
-            std::cout << "ERROR: Unknown UDP packet type: " << int(type) << "\n";
-            comms->send_udp_message(Toolkit::build_confirm(msg_id));
+            out() << "ERROR: Unknown UDP packet type: " << int(type) << "\n";
+            confirm(msg_id);
             auto e_msg_id = comms->next_msg_id();
             auto err_dk = "ERROR: Unknown UDP packet type";
             auto err_msg = Toolkit::build_msg(e_msg_id, this->display_name,
-                                              err_dk, true);
-            comms->send_udp_message(err_msg);
+                                              err_dk, true, &arena);
+            send_message(err_msg);
             break;
     }
-    processed_ids.insert(msg_id);
 }
 
-void Client_Session::handle_udp_confirm(const std::vector<uint8_t>& pac) {
-    uint16_t msg_id = (pac[1] <<8 | pac[2]);
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_confirm(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
+    [[maybe_unused]] uint16_t msg_id = (pac[1] <<8 | pac[2]); // printf_debug() only
     printf_debug("Received CONFIRM for msg_id: %d", msg_id);
 }
 
-void Client_Session::handle_udp_reply(const std::vector<uint8_t>& pac) { 
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_reply(std::span<const uint8_t> pac) requires (Transport::needs_confirm) { 
     uint16_t msg_id = (pac[1] << 8) | pac[2];
     uint8_t result = pac[3];
     //uint16_t ref_msg_id = (pac[4] << 8) | pac[5];
-    std::string msg_content;
-    
-    for (size_t i = 6; i < pac.size() && pac[i] != 0x00; ++i) {
-        msg_content += static_cast<char>(pac[i]);
-    }
+    std::string_view msg_content = Toolkit::read_string(pac, 6);
 
-    if (result == 0) {
-        std::cout << "Action Failure: " << msg_content << "\n";
-    } else { // Assuming the other number is one
-        std::cout << "Action Success: " << msg_content << "\n";
-    }
+    // Assuming the other number is one
+    emit(result == 0 ? Record_Type::Reply_Nok : Record_Type::Reply_Ok, "", msg_content, msg_id);
 
-    comms->send_udp_message(Toolkit::build_confirm(msg_id));
+    confirm(msg_id);
     
     if (state == ClientState::Auth) {
 
         printf_debug("REPLY RECEIVED %d", result);
-        state = (result == 1 ? ClientState::Open : ClientState::Start);
+        set_state(result == 1 ? ClientState::Open : ClientState::Start);
     } else if (state == ClientState::Join) {
-        state = ClientState::Open;
+        if (result == 1) {
+            channel_joined();
+        }
+        set_state(ClientState::Open);
     } else {
         graceful_exit(ERR_SERVER);
     }    
 }
 
-void Client_Session::handle_udp_msg(const std::vector<uint8_t>& pac) {
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_msg(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
     printf_debug("Receiving ");
     uint16_t msg_id = (pac[1] << 8) | pac[2];
-    std::string disp_name;
-    std::string msg_content;
-
-    size_t pos = 3;
-    while(pos < pac.size() && pac[pos] != 0x00) {
-        disp_name += static_cast<char>(pac[pos]);
-        pos++;
-    }
-    for(pos++; pos < pac.size() && pac[pos] != 0x00; pos++) {
-        msg_content += static_cast<char>(pac[pos]);
-    }
-    std::cout << disp_name << ": " << msg_content << std::endl;
+    std::string_view disp_name = Toolkit::read_string(pac, 3);
+    std::string_view msg_content = Toolkit::read_string(pac, 3 + disp_name.size() + 1);
+    emit(Record_Type::Msg, disp_name, msg_content, msg_id);
 
-    comms->send_udp_message(Toolkit::build_confirm(msg_id));
+    confirm(msg_id);
 }
 
-void Client_Session::handle_udp_ping(const std::vector<uint8_t>& pac) {
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_ping(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
     printf_debug("Pinged ^w^");
     uint16_t msg_id = (pac[1] << 8) | pac[2];
-    comms->send_udp_message(Toolkit::build_confirm(msg_id));
+    confirm(msg_id);
 }
 
-void Client_Session::handle_udp_err(const std::vector<uint8_t>& pac) {
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_err(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
     printf_debug("Receiving ");
     uint16_t msg_id = (pac[1] << 8) | pac[2];
-    std::string disp_name;
-    std::string msg_content;
-
-    size_t pos = 3;
-    while(pos < pac.size() && pac[pos] != 0x00) {
-        disp_name += static_cast<char>(pac[pos]);
-        pos++;
-    }
-    for(pos++; pos < pac.size() && pac[pos] != 0x00; pos++) {
-        msg_content += static_cast<char>(pac[pos]);
-    }
-    std::cout << "ERROR FROM " << disp_name << ": " << msg_content << std::endl;
+    std::string_view disp_name = Toolkit::read_string(pac, 3);
+    std::string_view msg_content = Toolkit::read_string(pac, 3 + disp_name.size() + 1);
+    emit(Record_Type::Err, disp_name, msg_content, msg_id);
 
-    comms->send_udp_message(Toolkit::build_confirm(msg_id));
+    confirm(msg_id);
 
 }
 
-void Client_Session::handle_udp_bye(const std::vector<uint8_t>& pac) {
+template <typename Transport>
+void Client_Session<Transport>::handle_udp_bye(std::span<const uint8_t> pac) requires (Transport::needs_confirm) {
     uint16_t ref_msg_id = (pac[1] << 8) | pac[2];
-    comms->send_udp_message(Toolkit::build_confirm(ref_msg_id));
-    for (int i = 0; i < config.get_retries(); ++i) {
-        auto pac = comms->timed_udp_reply();
+    confirm(ref_msg_id);
+    if (config.get_output() != Output_Mode::Text) { // no line for it in text
+        emit(Record_Type::Bye, Toolkit::read_string(pac, 3), "", ref_msg_id);
+    }
+    if (net) {
+        net->stop(); // linger below reads the socket directly
+    }
+    // capture replay (-C) has no socket, retransmitted BYEs are just the next frames
+    for (int i = 0; i < config.get_retries() && !comms->is_offline(); ++i) {
+        auto linger = timers.schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(config.get_timeout()));
+        auto pac = udp_reply_before(linger);
         if (!pac) break; // no retransmissions received
+        timers.cancel(linger);
 
         if ((*pac)[0] == 0xFF) { // FF = BYE
             uint16_t msg_id = ((*pac)[1] << 8) | (*pac)[2];
-            comms->send_udp_message(Toolkit::build_confirm(msg_id));
+            comms->send_udp_message(Toolkit::build_confirm(msg_id, &arena));
             printf_debug("Resent confirm for BYE msg_id: %d", msg_id);
         }
     }
@@ -576,3 +1565,7 @@ void Client_Session::handle_udp_bye(const std::vector<uint8_t>& pac) {
     printf_debug("Ending program");
     graceful_exit(0);
 }
+
+// both variants are built here, main() picks one by -t
+template class Client_Session<Tcp_Transport>;
+template class Client_Session<Udp_Transport>;
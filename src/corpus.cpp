@@ -0,0 +1,71 @@
+/**
+ * @file corpus.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "corpus.h"
+#include "tools.h"
+
+#include <cstring>
+
+Corpus::Corpus(const std::string &path) 
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open message file: " << path << "\n";
+        exit(ERR_INVALID);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        perror("ERROR: fstat");
+        close(fd);
+        exit(ERR_INTERNAL);
+    }
+    this->map_size = st.st_size;
+
+    if (map_size > 0) {
+        void *addr = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("ERROR: mmap");
+            close(fd);
+            exit(ERR_INTERNAL);
+        }
+        madvise(addr, map_size, MADV_SEQUENTIAL);
+        this->map = static_cast<const char*>(addr);
+    }
+    close(fd); // mapping stays valid
+
+    split_lines();
+    printf_debug("Mapped %zu bytes, %zu lines from %s", map_size, lines.size(), path.c_str());
+}
+
+Corpus::~Corpus() {
+    if (map) {
+        munmap(const_cast<char*>(map), map_size);
+    }
+}
+
+const std::vector<std::string_view>& Corpus::get_lines() const { return lines; }
+size_t Corpus::get_size() const { return map_size; }
+
+void Corpus::split_lines() 
+{
+    const char *pos = map;
+    const char *end = map + map_size;
+
+    while (pos < end) {
+        auto nl = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        const char *line_end = nl ? nl : end;
+
+        std::string_view line(pos, line_end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1); // files with CRLF line endings
+        }
+        lines.push_back(line);
+
+        pos = line_end + 1;
+    }
+}
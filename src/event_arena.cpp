@@ -0,0 +1,72 @@
+/**
+ * @file event_arena.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "event_arena.h"
+
+#include <new>
+#include <cstdlib>
+
+static std::atomic<uint64_t> allocations{0};
+
+/**
+ * @brief replaces the global allocator to count its calls, array and nothrow
+ * forms end up here as well, delete is left to the default (free())
+ */
+void *operator new(std::size_t size) 
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    while (true) {
+        void *p = std::malloc(size);
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+uint64_t global_allocations() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+Event_Arena::Event_Arena() 
+    : pool(buffer, sizeof(buffer), std::pmr::new_delete_resource()) {}
+
+void Event_Arena::reset() 
+{
+    if (started) { // setup before the first event isn't counted
+        events++;
+        if (used > sizeof(buffer)) overflows++;
+        if (global_allocations() != allocs_seen) dirty++;
+        peak = std::max(peak, used);
+    }
+    started = true;
+    used = 0;
+    pool.release(); // back to the start of buffer, overflow is freed
+    allocs_seen = global_allocations();
+}
+
+void *Event_Arena::do_allocate(size_t bytes, size_t alignment) 
+{
+    used += bytes;
+    return pool.allocate(bytes, alignment);
+}
+
+void Event_Arena::do_deallocate(void *, size_t, size_t) {
+    // monotonic, reclaimed by reset()
+}
+
+bool Event_Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+void Event_Arena::print(std::ostream &out) const 
+{
+    out << "Event loop: " << events << " events, " << dirty
+        << " of them called the global allocator, arena peak " << peak
+        << " bytes (" << overflows << " overflows)\n";
+}
@@ -0,0 +1,134 @@
+/**
+ * @file flight_recorder.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "flight_recorder.h"
+#include "tools.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+Flight_Recorder flight_recorder;
+
+Flight_Recorder::Flight_Recorder() {
+    set_path("/tmp/ipk25chat-flight-" + std::to_string(getpid()));
+}
+
+void Flight_Recorder::set_path(const std::string &base) 
+{
+    this->text_path = base + ".txt";
+    snprintf(bin_path, sizeof(bin_path), "%s.bin", base.c_str());
+}
+
+void Flight_Recorder::record(Ring ring, const void *data, size_t len, uint16_t msg_id) 
+{
+    Ring_Buffer &rb = rings[ring];
+    uint64_t n = rb.head.fetch_add(1, std::memory_order_relaxed);
+    size_t i = n % FLIGHT_SLOTS;
+    uint32_t seq = static_cast<uint32_t>(n) * 2 + 2;
+
+    rb.seq[i].store(seq - 1, std::memory_order_relaxed); // odd = being written
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Flight_Entry &e = rb.slots[i];
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    e.ts_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+    e.len = len;
+    e.msg_id = msg_id;
+    e.ring = ring;
+    e.snap = std::min<size_t>(len, FLIGHT_SNAP);
+    memcpy(e.data, data, e.snap);
+
+    rb.seq[i].store(seq, std::memory_order_release);
+}
+
+void Flight_Recorder::event(const char *text) {
+    record(EVENT, text, strlen(text));
+}
+
+void Flight_Recorder::dump_binary() 
+{
+    int fd = open(bin_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return;
+
+    uint32_t header[2] = {FLIGHT_SLOTS, sizeof(Flight_Entry)};
+    ssize_t ok = write(fd, "IPKFLT01", 8);
+    ok = write(fd, header, sizeof(header));
+    for (auto &rb : rings) {
+        ok = write(fd, rb.slots, sizeof(rb.slots));
+        ok = write(fd, rb.seq, sizeof(rb.seq)); // lock-free atomics have the layout of uint32_t
+    }
+    (void)ok;
+    close(fd);
+}
+
+void Flight_Recorder::handle_sigusr2(int) {
+    flight_recorder.dump_binary();
+    flight_recorder.dumps.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t Flight_Recorder::dump_count() const {
+    return dumps.load(std::memory_order_relaxed);
+}
+
+void Flight_Recorder::dump_text() 
+{
+    std::ofstream out(text_path, std::ios::trunc);
+    if (!out) return;
+
+    static const char *names[RING_COUNT] = {"IN ", "OUT", "EVT"};
+    struct Item { uint32_t seq; Flight_Entry entry; };
+    std::vector<Item> items;
+
+    for (auto &rb : rings) {
+        for (size_t i = 0; i < FLIGHT_SLOTS; i++) {
+            uint32_t before = rb.seq[i].load(std::memory_order_acquire);
+            if (before == 0 || before % 2) continue; // empty or torn
+            Item item{before, rb.slots[i]};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (rb.seq[i].load(std::memory_order_relaxed) != before) continue;
+            items.push_back(item);
+        }
+    }
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+        return a.entry.ts_ns < b.entry.ts_ns;
+    });
+
+    for (auto &item : items) {
+        const Flight_Entry &e = item.entry;
+        char ts[32];
+        snprintf(ts, sizeof(ts), "%llu.%09llu", (unsigned long long)(e.ts_ns / 1000000000ULL), 
+                 (unsigned long long)(e.ts_ns % 1000000000ULL));
+        out << ts << " " << names[e.ring];
+        if (e.msg_id != 0xFFFF) {
+            out << " msg_id=" << e.msg_id;
+        }
+        if (e.ring != EVENT) {
+            out << " len=" << e.len;
+        }
+        out << " ";
+        for (size_t i = 0; i < e.snap; i++) {
+            unsigned char c = e.data[i];
+            if (c >= 0x20 && c < 0x7F && c != '\\') {
+                out << c;
+            } else {
+                char hex[5];
+                snprintf(hex, sizeof(hex), "\\x%02x", c);
+                out << hex;
+            }
+        }
+        if (e.len > e.snap) out << "...";
+        out << "\n";
+    }
+    std::cerr << "Flight recorder dumped to " << text_path << "\n";
+}
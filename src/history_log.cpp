@@ -0,0 +1,196 @@
+/**
+ * @file history_log.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "history_log.h"
+#include "tools.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <filesystem>
+#include <cctype>
+
+#define HISTORY_MAGIC "IPKH"
+#define HISTORY_VERSION 1
+
+History_Log::History_Log(const std::string &dir, bool hosted) : dir(dir), hosted(hosted)
+{
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        std::cerr << "ERROR: Cannot create history directory: " << dir << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+}
+
+History_Log::~History_Log()
+{
+    if (current.map) {
+        munmap(current.map, SEGMENT_SIZE);
+    }
+}
+
+std::string History_Log::segment_path(uint32_t number) const
+{
+    char name[16];
+    snprintf(name, sizeof(name), ".%06u.hist", number);
+    return dir + "/" + channel + name;
+}
+
+/**
+ * @brief maps a segment file, a writable one is created (sparse) if it doesn't exist
+ */
+History_Log::Segment History_Log::map_segment(uint32_t number, bool writable)
+{
+    std::string path = segment_path(number);
+    int fd = open(path.c_str(), writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0600);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open history segment: " << path << "\n";
+        Toolkit::fail(ERR_INTERNAL, hosted);
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    bool fresh = st.st_size == 0;
+    if (!writable && static_cast<size_t>(st.st_size) < SEGMENT_SIZE) { // pages past the end would be SIGBUS
+        close(fd);
+        std::cerr << "ERROR: Truncated history segment: " << path << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+    if (writable && static_cast<size_t>(st.st_size) < SEGMENT_SIZE && ftruncate(fd, SEGMENT_SIZE) != 0) {
+        perror("ERROR: ftruncate");
+        close(fd);
+        Toolkit::fail(ERR_INTERNAL, hosted);
+    }
+
+    Segment seg;
+    void *addr = mmap(nullptr, SEGMENT_SIZE, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // mapping stays valid
+    if (addr == MAP_FAILED) {
+        perror("ERROR: mmap");
+        Toolkit::fail(ERR_INTERNAL, hosted);
+    }
+    seg.map = static_cast<char*>(addr);
+    seg.header = reinterpret_cast<Segment_Header*>(seg.map);
+    seg.index = reinterpret_cast<uint32_t*>(seg.map + INDEX_OFFSET);
+    seg.data = seg.map + DATA_OFFSET;
+
+    if (writable && fresh) {
+        memcpy(seg.header->magic, HISTORY_MAGIC, 4);
+        seg.header->version = HISTORY_VERSION;
+    } else if (memcmp(seg.header->magic, HISTORY_MAGIC, 4) != 0 || seg.header->version != HISTORY_VERSION) {
+        std::cerr << "ERROR: Not a history segment: " << path << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+    // counters come from the file, everything read through them has to stay in the mapping
+    if (seg.header->bytes > HISTORY_SEGMENT_DATA || seg.header->lines > HISTORY_SEGMENT_LINES) {
+        std::cerr << "ERROR: Corrupted history segment: " << path << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+    return seg;
+}
+
+void History_Log::open_channel(std::string_view name)
+{
+    if (current.map && name == channel) return;
+    if (current.map) {
+        munmap(current.map, SEGMENT_SIZE);
+        current = Segment();
+    }
+    this->channel = name;
+
+    // <channel>.<number>.hist
+    segments.clear();
+    std::error_code ec;
+    std::filesystem::directory_iterator files(dir, ec); // throwing one would abort every session
+    if (ec) {
+        std::cerr << "ERROR: Cannot read history directory: " << dir << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+    for (const auto &entry : files) {
+        std::string file = entry.path().filename().string();
+        if (file.size() != channel.size() + 12 || file.compare(0, channel.size(), channel) != 0
+            || file.compare(file.size() - 5, 5, ".hist") != 0 || file[channel.size()] != '.') {
+            continue;
+        }
+        std::string number = file.substr(channel.size() + 1, 6);
+        if (!std::all_of(number.begin(), number.end(), ::isdigit)) continue;
+        segments.push_back(std::stoul(number));
+    }
+    std::sort(segments.begin(), segments.end());
+    if (segments.empty()) {
+        segments.push_back(0);
+    }
+    current = map_segment(segments.back(), true);
+    printf_debug("History of %s: %zu segments", channel.c_str(), segments.size());
+}
+
+void History_Log::rotate()
+{
+    munmap(current.map, SEGMENT_SIZE);
+    current = Segment(); // not unmapped again if the next one fails
+    segments.push_back(segments.back() + 1);
+    current = map_segment(segments.back(), true);
+}
+
+void History_Log::append(std::string_view name, std::string_view content)
+{
+    size_t len = name.size() + 2 + content.size() + 1;
+    if (current.header->lines == HISTORY_SEGMENT_LINES || current.header->bytes + len > HISTORY_SEGMENT_DATA) {
+        rotate();
+    }
+    uint32_t offset = current.header->bytes;
+    char *pos = current.data + offset;
+    memcpy(pos, name.data(), name.size());
+    pos += name.size();
+    memcpy(pos, ": ", 2);
+    memcpy(pos + 2, content.data(), content.size());
+    pos[2 + content.size()] = '\n';
+
+    current.index[current.header->lines] = offset;
+    current.header->bytes = offset + len;
+    current.header->lines++; // a line cut off by a crash is not counted
+}
+
+/**
+ * @brief walks segments back until count lines are covered, then writes each
+ * segment's part as one block, nothing is copied to the heap
+ */
+void History_Log::print_last(size_t count, int fd)
+{
+    struct Part {
+        Segment seg;
+        uint32_t from; // first line
+        bool mapped;   // older segment, unmapped afterwards
+    };
+    std::vector<Part> parts; // one per segment, not per line
+    for (size_t i = segments.size(); i-- > 0 && count > 0; ) {
+        bool newest = i + 1 == segments.size();
+        Segment seg = newest ? current : map_segment(segments[i], false);
+        uint32_t lines = seg.header->lines;
+        uint32_t take = std::min<size_t>(count, lines);
+        parts.push_back({seg, lines - take, !newest});
+        count -= take;
+    }
+
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+        const Segment &seg = it->seg;
+        uint32_t start = it->from < seg.header->lines ? seg.index[it->from] : seg.header->bytes;
+        if (start > seg.header->bytes) {
+            std::cerr << "ERROR: Corrupted history index of " << channel << ", segment skipped\n";
+            start = seg.header->bytes;
+        }
+        const char *pos = seg.data + start;
+        size_t left = seg.header->bytes - start;
+        while (left > 0) {
+            ssize_t written = write(fd, pos, left);
+            if (written <= 0) break;
+            pos += written;
+            left -= written;
+        }
+        if (it->mapped) {
+            munmap(seg.map, SEGMENT_SIZE);
+        }
+    }
+}
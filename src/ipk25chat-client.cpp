@@ -8,13 +8,14 @@
 #include "tools.h"
 #include "client_init.h"
 #include "client_session.h"
+#include "transport_probe.h"
 #include <set>
 
  int main(int argc, char **argv) {
     Client_Init config;
 
     // Small function to check if the next argument is present
-    std::set<std::string> params = {"-t", "-s", "-p", "-d", "-r", "-h"};
+    std::set<std::string> params = {"-t", "-s", "-p", "-d", "-r", "-f", "-w", "-T", "-U", "-R", "-b", "-P", "-L", "-c", "-C", "-F", "-O", "-A", "-J", "-H", "-S", "-I", "-o", "-B", "-K", "-h"};
     auto get_next_arg = [&](int &i, const std::string &flag) -> std::string {
         if (i + 1 < argc && !params.contains(argv[i + 1])) {
             return argv[++i];
@@ -41,6 +42,69 @@
         else if (arg == "-r") {
             config.set_udp_retries(get_next_arg(i, arg));
         }
+        else if (arg == "-f") {
+            config.set_corpus(get_next_arg(i, arg));
+        }
+        else if (arg == "-w") {
+            config.set_pacing(get_next_arg(i, arg));
+        }
+        else if (arg == "-T") {
+            config.set_threaded(true);
+        }
+        else if (arg == "-U") {
+            config.set_uring(true);
+        }
+        else if (arg == "-R") {
+            config.set_cache_ttl(get_next_arg(i, arg));
+        }
+        else if (arg == "-b") {
+            config.set_sock_buffer(get_next_arg(i, arg));
+        }
+        else if (arg == "-P") {
+            config.set_busy_poll(get_next_arg(i, arg));
+        }
+        else if (arg == "-L") {
+            config.set_latency(true);
+        }
+        else if (arg == "-c") {
+            config.set_capture(get_next_arg(i, arg));
+        }
+        else if (arg == "-C") {
+            config.set_replay(get_next_arg(i, arg));
+        }
+        else if (arg == "-F") {
+            config.set_flight_path(get_next_arg(i, arg));
+        }
+        else if (arg == "-O") {
+            config.set_reorder_wait(get_next_arg(i, arg));
+        }
+        else if (arg == "-A") {
+            config.set_reconnect(get_next_arg(i, arg));
+        }
+        else if (arg == "-J") {
+            config.set_journal(get_next_arg(i, arg));
+        }
+        else if (arg == "-H") {
+            config.set_history(get_next_arg(i, arg));
+        }
+        else if (arg == "-S") {
+            config.set_search(true);
+        }
+        else if (arg == "-I") {
+            config.set_ingest(get_next_arg(i, arg));
+        }
+        else if (arg == "-o") {
+            config.set_output(get_next_arg(i, arg));
+        }
+        else if (arg.starts_with("--output=")) {
+            config.set_output(arg.substr(9));
+        }
+        else if (arg == "-B") {
+            config.set_rate(get_next_arg(i, arg));
+        }
+        else if (arg == "-K") {
+            config.set_keepalive(get_next_arg(i, arg));
+        }
         else if (arg == "-h" || arg == "--help") {
             config.print_help(); // help exits the program
         }
@@ -49,8 +113,17 @@
         }
     }
 
+    if (config.is_auto() && !config.get_hostname().empty() && config.get_replay().empty()) {
+        Transport_Probe probe(config); // before validate(), its warnings follow the choice
+        config.set_probed(probe.run(), probe.get_socket());
+    }
     config.validate();
-    Client_Session session(config);
-    session.run();
+    if (config.is_tcp()) {
+        Client_Session<Tcp_Transport> session(config);
+        session.run();
+    } else {
+        Client_Session<Udp_Transport> session(config);
+        session.run();
+    }
     return 0;
 }
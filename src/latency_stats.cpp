@@ -0,0 +1,39 @@
+/**
+ * @file latency_stats.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <numeric>
+
+void Latency_Stats::reserve() {
+    samples.reserve(LATENCY_RESERVE);
+}
+
+void Latency_Stats::add(std::chrono::nanoseconds sample) {
+    samples.push_back(sample.count());
+}
+
+bool Latency_Stats::empty() const {
+    return samples.empty();
+}
+
+void Latency_Stats::print(std::ostream &out, const std::string &name) const 
+{
+    if (samples.empty()) return;
+
+    std::vector<int64_t> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    auto pct = [&](double p) { 
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))] / 1e3; 
+    };
+    double avg = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size() / 1e3;
+
+    out << name << ": " << sorted.size() << " samples, min " << sorted.front() / 1e3
+        << " us, avg " << avg << " us, p50 " << pct(0.5) << " us, p99 " << pct(0.99)
+        << " us, max " << sorted.back() / 1e3 << " us\n";
+}
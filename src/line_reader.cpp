@@ -0,0 +1,104 @@
+/**
+ * @file line_reader.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "line_reader.h"
+#include "tools.h"
+
+#include <algorithm>
+
+Line_Reader::Line_Reader(int fd) : fd(fd) {}
+
+// drop already processed lines before reading more
+void Line_Reader::compact() {
+    if (head > 0) {
+        data.erase(data.begin(), data.begin() + head);
+        head = 0;
+    }
+}
+
+bool Line_Reader::fill() 
+{
+    if (at_eof) return false;
+    if (full()) return true; // the caller stops polling stdin, see full()
+    compact();
+    if (data.capacity() < STDIN_CHUNK * 2) {
+        data.reserve(STDIN_CHUNK * 2); // on the first read, sessions opened by /open never read
+    }
+
+    size_t used = data.size();
+    data.resize(used + STDIN_CHUNK);
+    ssize_t bytes_rx = read(fd, data.data() + used, STDIN_CHUNK);
+
+    if (bytes_rx < 0) {
+        data.resize(used);
+        if (errno == EINTR || errno == EAGAIN) return true;
+        perror("ERROR: read stdin");
+        at_eof = true;
+        return false;
+    }
+    data.resize(used + bytes_rx);
+    printf_debug("Read %zd bytes from stdin", bytes_rx);
+
+    if (bytes_rx == 0) {
+        at_eof = true;
+        return false;
+    }
+    return true;
+}
+
+bool Line_Reader::feed(const char *buf, ssize_t bytes_rx) 
+{
+    if (at_eof) return false;
+
+    if (bytes_rx < 0) {
+        if (bytes_rx == -EINTR || bytes_rx == -EAGAIN) return true;
+        errno = -bytes_rx;
+        perror("ERROR: read stdin");
+        at_eof = true;
+        return false;
+    }
+    if (bytes_rx == 0) {
+        at_eof = true;
+        return false;
+    }
+
+    compact();
+    data.insert(data.end(), buf, buf + bytes_rx);
+    return true;
+}
+
+bool Line_Reader::pending() const {
+    return head < data.size();
+}
+
+bool Line_Reader::has_line() const {
+    if (head >= data.size()) return false;
+    return at_eof || full() || std::find(data.begin() + head, data.end(), '\n') != data.end();
+}
+
+bool Line_Reader::full() const {
+    return data.size() - head >= STDIN_MAX_BUFFERED;
+}
+
+bool Line_Reader::next_line(std::string &line) 
+{
+    if (head >= data.size()) return false;
+
+    auto begin = data.begin() + head;
+    auto nl = std::find(begin, data.end(), '\n');
+
+    if (nl == data.end()) {
+        if (!at_eof && !full()) return false; // wait for the rest of the line
+        line.assign(begin, data.end()); // last line without '\n' or one over the limit, split
+        head = data.size();
+        return true;
+    }
+
+    line.assign(begin, nl);
+    head += (nl - begin) + 1;
+    return true;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file net_thread.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "net_thread.h"
+#include "tools.h"
+
+Net_Thread::Net_Thread(Client_Comms &comms, uint16_t timeout, uint8_t retries)
+    : comms(comms), udp_timeout(timeout), retries(retries) 
+{
+    ui_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    net_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ui_efd < 0 || net_efd < 0) {
+        perror("ERROR: eventfd");
+        exit(ERR_INTERNAL);
+    }
+}
+
+Net_Thread::~Net_Thread() {
+    stop();
+    close(ui_efd);
+    close(net_efd);
+}
+
+void Net_Thread::start() 
+{
+    // SIGINT has to be handled by the session thread
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    this->thread = std::thread(&Net_Thread::loop, this);
+    this->started = true;
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    printf_debug("Network thread started");
+}
+
+void Net_Thread::stop(bool drain) 
+{
+    if (!started) return;
+    this->drain = drain;
+    stop_requested = true;
+    notify(net_efd);
+    thread.join();
+    started = false;
+    printf_debug("Network thread stopped");
+}
+
+bool Net_Thread::running() const { return started; }
+int Net_Thread::get_event_fd() const { return ui_efd; }
+
+void Net_Thread::notify(int efd) {
+    uint64_t one = 1;
+    if (write(efd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("ERROR: eventfd write");
+    }
+}
+
+void Net_Thread::clear_event_fd() {
+    uint64_t cnt;
+    if (read(ui_efd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+        perror("ERROR: eventfd read");
+    }
+}
+
+void Net_Thread::send(std::vector<uint8_t> &&pac, bool confirm) 
+{
+    Net_Request req{std::move(pac), confirm};
+    while (!outbound.push(std::move(req))) {
+        std::this_thread::yield(); // backpressure, network thread keeps confirming
+    }
+    notify(net_efd);
+}
+
+bool Net_Thread::next_event(Net_Event &ev) {
+    if (inbound.pop(ev)) return true;
+    if (started || backlog.empty()) return false;
+
+    ev = std::move(backlog.front()); // joined, the backlog is ours now
+    backlog.pop_front();
+    return true;
+}
+
+/**
+ * @brief network thread only from here on
+ */
+void Net_Thread::loop() 
+{
+    int sock = comms.get_socket();
+    fd_set rfds;
+
+    while (true) {
+        FD_ZERO(&rfds);
+        FD_SET(sock, &rfds);
+        FD_SET(net_efd, &rfds);
+        int max_fd = std::max(sock, net_efd) + 1;
+
+        struct timeval tv{};
+        struct timeval *timeout = nullptr;
+        if (in_flight || !backlog.empty()) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                in_flight ? in_flight->deadline - std::chrono::steady_clock::now()
+                          : std::chrono::milliseconds(1)).count(); // retry full inbound queue
+            wait = std::max<long long>(wait, 0);
+            tv.tv_sec = wait / 1000000;
+            tv.tv_usec = wait % 1000000;
+            timeout = &tv;
+        }
+
+        int active = select(max_fd, &rfds, nullptr, nullptr, timeout);
+        if (active < 0) {
+            if (errno == EINTR) continue;
+            perror("ERROR: network thread select");
+            break;
+        }
+
+        if (FD_ISSET(net_efd, &rfds)) {
+            uint64_t cnt;
+            if (read(net_efd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+                perror("ERROR: eventfd read");
+            }
+        }
+
+        Net_Request req;
+        while (outbound.pop(req)) {
+            if (req.confirm) {
+                waiting.push_back(std::move(req));
+            } else {
+                comms.send_udp_message(req.data); // not subject to the window
+            }
+        }
+
+        if (FD_ISSET(sock, &rfds)) {
+            handle_packet(comms.receive_udp_message());
+        }
+
+        check_in_flight();
+        flush_backlog();
+
+        if (stop_requested && (!drain || (!in_flight && waiting.empty()))) break;
+    }
+}
+
+void Net_Thread::handle_packet(Toolkit::Bytes &&pac) 
+{
+    heard.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    if (pac.size() < 3) {
+        std::cerr << "ERROR: Empty or malformed UDP packet received\n";
+        return;
+    }
+
+    uint8_t type = pac[0];
+    uint16_t msg_id = (pac[1] << 8) | pac[2];
+
+    if (type == 0x00) { // CONFIRM
+        if (in_flight && in_flight->msg_id == msg_id) {
+            printf_debug("Received CONFIRM for msg_id: %d", msg_id);
+            in_flight.reset();
+            post(Net_Event{Net_Event::Type::Confirmed, msg_id, {}}); // e.g. for the journal (-J)
+        }
+        return;
+    }
+
+    comms.send_udp_message(Toolkit::build_confirm(msg_id));
+    if (processed_ids.contains(msg_id)) {
+        printf_debug("Received duplicate msg_id: %d. Resent confirm", msg_id);
+        return;
+    }
+    processed_ids.insert(msg_id);
+
+    if (type == 0xFD) { // PING
+        printf_debug("Pinged ^w^");
+        return;
+    }
+    post(Net_Event{Net_Event::Type::Packet, msg_id, std::move(pac)});
+}
+
+void Net_Thread::check_in_flight() 
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (in_flight && now >= in_flight->deadline) {
+        if (in_flight->tries < retries) {
+            printf_debug("Retry %d for msg_id %d", in_flight->tries, in_flight->msg_id);
+            comms.send_udp_message(in_flight->req.data);
+            post(Net_Event{Net_Event::Type::Retried, in_flight->msg_id, {}}); // for the pacer (-B)
+            in_flight->tries++;
+            in_flight->deadline = now + std::chrono::milliseconds(udp_timeout);
+        } else {
+            post(Net_Event{Net_Event::Type::GaveUp, in_flight->msg_id, {}});
+            in_flight.reset();
+            drain = false; // server is gone, don't wait for the rest
+        }
+    }
+
+    while (!in_flight && !waiting.empty()) {
+        Net_Request req = std::move(waiting.front());
+        waiting.pop_front();
+        uint16_t msg_id = (req.data[1] << 8) | req.data[2];
+
+        if (retries == 0) { // same as send_with_retries(), nothing is sent
+            post(Net_Event{Net_Event::Type::GaveUp, msg_id, {}});
+            continue;
+        }
+        comms.send_udp_message(req.data);
+        in_flight = In_Flight{std::move(req), msg_id, 1,
+                              now + std::chrono::milliseconds(udp_timeout)};
+    }
+}
+
+std::chrono::steady_clock::time_point Net_Thread::last_heard() const {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(heard.load(std::memory_order_relaxed)));
+}
+
+void Net_Thread::post(Net_Event &&ev) {
+    backlog.push_back(std::move(ev));
+}
+
+void Net_Thread::flush_backlog() 
+{
+    bool pushed = false;
+    while (!backlog.empty() && inbound.push(std::move(backlog.front()))) {
+        backlog.pop_front();
+        pushed = true;
+    }
+    if (pushed) notify(ui_efd);
+}
@@ -0,0 +1,237 @@
+/**
+ * @file outbox_journal.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "outbox_journal.h"
+#include "tools.h"
+
+#include <cstring>
+#include <utility> // std::exchange
+#include <algorithm>
+
+#define JOURNAL_MAGIC "IPKJ"
+#define JOURNAL_VERSION 1
+#define RECORD_MAGIC 0x4d534731 // "MSG1"
+
+Outbox_Journal::Outbox_Journal(const std::string &path, bool hosted) : path(path), hosted(hosted)
+{
+    this->fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open outbox journal: " << path << "\n";
+        fail(ERR_INVALID);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        perror("ERROR: fstat");
+        fail(ERR_INTERNAL);
+    }
+    bool fresh = st.st_size == 0;
+    if (!fresh && static_cast<size_t>(st.st_size) < sizeof(File_Header)) {
+        std::cerr << "ERROR: Not an outbox journal: " << path << "\n";
+        fail(ERR_INVALID);
+    }
+
+    grow(fresh ? JOURNAL_CHUNK : st.st_size);
+
+    if (fresh) {
+        memcpy(header()->magic, JOURNAL_MAGIC, 4);
+        header()->version = JOURNAL_VERSION;
+        header()->epoch = 0;
+        mark_dirty(0, sizeof(File_Header));
+        sync(true);
+    } else if (memcmp(header()->magic, JOURNAL_MAGIC, 4) != 0 || header()->version != JOURNAL_VERSION) {
+        std::cerr << "ERROR: Not an outbox journal: " << path << "\n";
+        fail(ERR_INVALID);
+    }
+
+    scan();
+    printf_debug("Journal %s: %zu bytes mapped, %zu pending", path.c_str(), map_size, pending_records);
+}
+
+Outbox_Journal::~Outbox_Journal()
+{
+    if (map) {
+        sync(true);
+        munmap(map, map_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void Outbox_Journal::fail(int ex_code)
+{
+    if (map) {
+        munmap(map, map_size); // pending records are already in the file
+        map = nullptr;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    Toolkit::fail(ex_code, hosted);
+}
+
+Outbox_Journal::File_Header* Outbox_Journal::header() {
+    return reinterpret_cast<File_Header*>(map);
+}
+
+Outbox_Journal::Record_Header* Outbox_Journal::record(uint64_t id) {
+    return reinterpret_cast<Record_Header*>(map + id);
+}
+
+size_t Outbox_Journal::pending() const { return pending_records; }
+
+/**
+ * @brief extends the file and the mapping to at least min_size,
+ * records are addressed by offset so the mapping may move
+ */
+void Outbox_Journal::grow(size_t min_size)
+{
+    size_t size = std::max(map_size, static_cast<size_t>(JOURNAL_CHUNK));
+    while (size < min_size) size += JOURNAL_CHUNK;
+    if (size == map_size) return;
+
+    if (ftruncate(fd, size) != 0) {
+        perror("ERROR: ftruncate");
+        fail(ERR_INTERNAL);
+    }
+    void *addr = map ? mremap(map, map_size, size, MREMAP_MAYMOVE)
+                     : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        perror("ERROR: mmap");
+        fail(ERR_INTERNAL);
+    }
+    this->map = static_cast<char*>(addr);
+    this->map_size = size;
+}
+
+/**
+ * @brief walks the records of the current epoch, a torn or foreign record ends the journal
+ */
+void Outbox_Journal::scan()
+{
+    uint32_t epoch = header()->epoch;
+    size_t pos = sizeof(File_Header);
+
+    while (pos + sizeof(Record_Header) <= map_size) {
+        Record_Header *r = record(pos);
+        if (r->magic != RECORD_MAGIC || r->epoch != epoch
+            || pos + sizeof(Record_Header) + r->length > map_size) {
+            break;
+        }
+        std::string_view content(map + pos + sizeof(Record_Header), r->length);
+        if (r->checksum != checksum(content)) {
+            break; // crashed while appending, it was never sent
+        }
+        if (r->state == PENDING) {
+            recovered_entries.push_back({pos, std::string(content)});
+            pending_records++;
+        }
+        pos += (sizeof(Record_Header) + r->length + 3) & ~size_t(3);
+    }
+    this->end = pos;
+}
+
+uint64_t Outbox_Journal::append(std::string_view content)
+{
+    size_t size = (sizeof(Record_Header) + content.size() + 3) & ~size_t(3);
+    grow(end + size + sizeof(Record_Header)); // room for the next header as well
+
+    uint64_t id = end;
+    Record_Header *r = record(id);
+    memcpy(map + id + sizeof(Record_Header), content.data(), content.size());
+    r->epoch = header()->epoch;
+    r->length = content.size();
+    r->checksum = checksum(content);
+    r->state = PENDING;
+    r->magic = RECORD_MAGIC;
+    memset(map + id + size, 0, sizeof(Record_Header)); // stale bytes after the end are not read as a record
+
+    mark_dirty(id, id + size + sizeof(Record_Header));
+    this->end += size;
+    pending_records++;
+
+    if (unsynced >= JOURNAL_BATCH) {
+        sync(); // a burst doesn't wait for the end of the iteration
+    }
+    return id;
+}
+
+void Outbox_Journal::delivered(uint64_t id)
+{
+    Record_Header *r = record(id);
+    if (r->state != PENDING) return;
+
+    r->state = DELIVERED;
+    mark_dirty(id, id + sizeof(Record_Header));
+    pending_records--;
+}
+
+/**
+ * @brief called once per loop iteration, new changes only start their writeback
+ * (MS_ASYNC). One MS_SYNC covers everything changed since the previous one after
+ * JOURNAL_BATCH changes, JOURNAL_SYNC_MS, or when now (exit). When nothing is
+ * pending the journal starts over in a new epoch instead of growing.
+ */
+void Outbox_Journal::sync(bool now)
+{
+    if (pending_records == 0 && end > sizeof(File_Header)) {
+        header()->epoch++;
+        this->end = sizeof(File_Header);
+        mark_dirty(0, sizeof(File_Header));
+    }
+    if (dirty_from >= dirty_to) return;
+
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    size_t from = dirty_from & ~(page - 1);
+    bool boundary = now || unsynced >= JOURNAL_BATCH || std::chrono::steady_clock::now() >= *sync_due();
+    if (!boundary) {
+        if (async_pending && msync(map + from, dirty_to - from, MS_ASYNC) != 0) {
+            perror("WARNING: msync");
+        }
+        this->async_pending = false;
+        return;
+    }
+    if (msync(map + from, dirty_to - from, MS_SYNC) != 0) {
+        perror("WARNING: msync");
+    }
+    this->dirty_from = SIZE_MAX;
+    this->dirty_to = 0;
+    this->unsynced = 0;
+    this->async_pending = false;
+}
+
+std::optional<std::chrono::steady_clock::time_point> Outbox_Journal::sync_due() const
+{
+    if (dirty_from >= dirty_to) return std::nullopt;
+    return dirty_since + std::chrono::milliseconds(JOURNAL_SYNC_MS);
+}
+
+std::vector<Outbox_Journal::Entry> Outbox_Journal::recovered() {
+    return std::exchange(recovered_entries, {});
+}
+
+void Outbox_Journal::mark_dirty(size_t from, size_t to)
+{
+    if (dirty_from >= dirty_to) {
+        dirty_since = std::chrono::steady_clock::now();
+    }
+    unsynced++;
+    async_pending = true;
+    dirty_from = std::min(dirty_from, from);
+    dirty_to = std::max(dirty_to, std::min(to, map_size));
+}
+
+uint32_t Outbox_Journal::checksum(std::string_view content)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : content) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file output_writer.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "output_writer.h"
+#include "tools.h"
+
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Output_Writer output_writer;
+
+static const char *type_names[] = {"", "msg", "reply_ok", "reply_nok", "err", "bye"};
+
+Output_Writer::~Output_Writer()
+{
+    flush();
+}
+
+void Output_Writer::set_mode(Output_Mode mode)
+{
+    this->mode = mode;
+    buffer.reserve(OUTPUT_BUFFER * 2);
+}
+
+Output_Mode Output_Writer::get_mode() const
+{
+    return mode;
+}
+
+void Output_Writer::flush()
+{
+    const char *pos = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0) {
+        ssize_t written = write(STDOUT_FILENO, pos, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break; // stdout closed, records are dropped
+        pos += written;
+        left -= written;
+    }
+    buffer.clear();
+}
+
+/**
+ * @brief appends value with '"', '\' and control characters escaped, spans
+ * without any are copied as a whole
+ */
+void Output_Writer::append_escaped(std::string_view value)
+{
+    const char *data = value.data();
+    size_t size = value.size();
+    size_t i = 0;
+    while (i < size) {
+        size_t clean = i;
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+        while (clean + 16 <= size) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + clean));
+            __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk)); // <= 0x1F
+            int mask = _mm_movemask_epi8(special);
+            if (mask != 0) {
+                clean += __builtin_ctz(mask);
+                break;
+            }
+            clean += 16;
+        }
+#endif
+        while (clean < size) { // the rest, or the first special byte of the chunk
+            unsigned char c = data[clean];
+            if (c == '"' || c == '\\' || c < 0x20) break;
+            clean++;
+        }
+        buffer.append(data + i, clean - i);
+        if (clean == size) break;
+
+        unsigned char c = data[clean];
+        switch (c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+            default: {
+                char hex[7];
+                snprintf(hex, sizeof(hex), "\\u%04x", c);
+                buffer += hex;
+            }
+        }
+        i = clean + 1;
+    }
+}
+
+void Output_Writer::append_json(std::string_view key, std::string_view value)
+{
+    buffer += ",\"";
+    buffer += key;
+    buffer += "\":\"";
+    append_escaped(value);
+    buffer += '"';
+}
+
+void Output_Writer::record(Record_Type type, std::string_view session, std::string_view channel,
+                           std::string_view sender, std::string_view content, int32_t msg_id, int64_t stamp_ns)
+{
+    if (mode == Output_Mode::Ndjson) {
+        buffer += "{\"type\":\"";
+        buffer += type_names[static_cast<int>(type)];
+        buffer += '"';
+        append_json("session", session);
+        append_json("channel", channel);
+        append_json("sender", sender);
+        append_json("content", content);
+
+        char number[24];
+        buffer += ",\"msg_id\":";
+        if (msg_id < 0) {
+            buffer += "null";
+        } else {
+            buffer.append(number, std::to_chars(number, number + sizeof(number), msg_id).ptr);
+        }
+        buffer += ",\"ts\":";
+        buffer.append(number, std::to_chars(number, number + sizeof(number), stamp_ns).ptr);
+        buffer += "}\n";
+    } else {
+        struct {
+            uint32_t length;
+            uint8_t type;
+            uint8_t reserved[3];
+            int32_t msg_id;
+            int64_t stamp_ns;
+            uint16_t session_len;
+            uint16_t channel_len;
+            uint16_t sender_len;
+            uint16_t reserved2;
+            uint32_t content_len;
+        } __attribute__((packed)) head{};
+        head.type = static_cast<uint8_t>(type);
+        head.msg_id = msg_id;
+        head.stamp_ns = stamp_ns;
+        head.session_len = static_cast<uint16_t>(session.size());
+        head.channel_len = static_cast<uint16_t>(channel.size());
+        head.sender_len = static_cast<uint16_t>(sender.size());
+        head.content_len = static_cast<uint32_t>(content.size());
+        head.length = static_cast<uint32_t>(sizeof(head) - sizeof(head.length)
+                      + session.size() + channel.size() + sender.size() + content.size());
+        buffer.append(reinterpret_cast<const char*>(&head), sizeof(head));
+        buffer += session;
+        buffer += channel;
+        buffer += sender;
+        buffer += content;
+    }
+    if (buffer.size() >= OUTPUT_BUFFER) {
+        flush();
+    }
+}
@@ -0,0 +1,282 @@
+/**
+ * @file pcap_file.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "pcap_file.h"
+#include "tools.h"
+
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <ctime>
+
+#include <arpa/inet.h>
+
+namespace {
+    // pcap headers are in the byte order of the machine which wrote them
+    struct Pcap_Header {
+        uint32_t magic;
+        uint16_t version_major;
+        uint16_t version_minor;
+        int32_t  thiszone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t network;
+    };
+
+    struct Pcap_Record {
+        uint32_t ts_sec;
+        uint32_t ts_frac; // ns or us, depends on the magic
+        uint32_t incl_len;
+        uint32_t orig_len;
+    };
+
+    void put16(std::vector<uint8_t> &buf, uint16_t value) {
+        value = htons(value);
+        buf.insert(buf.end(), reinterpret_cast<uint8_t*>(&value), reinterpret_cast<uint8_t*>(&value) + 2);
+    }
+
+    void put32(std::vector<uint8_t> &buf, uint32_t value) {
+        value = htonl(value);
+        buf.insert(buf.end(), reinterpret_cast<uint8_t*>(&value), reinterpret_cast<uint8_t*>(&value) + 4);
+    }
+
+    uint16_t get16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+    uint32_t get32(const uint8_t *p) { return (uint32_t)get16(p) << 16 | get16(p + 2); }
+
+    uint32_t swap32(uint32_t value, bool swap) { return swap ? __builtin_bswap32(value) : value; }
+
+    // address bytes of sockaddr_storage, zeros if unknown
+    std::vector<uint8_t> ip_bytes(const sockaddr_storage &addr, int family) 
+    {
+        if (family == AF_INET6) {
+            std::vector<uint8_t> ip(16, 0);
+            if (addr.ss_family == AF_INET6) {
+                memcpy(ip.data(), &reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_addr, 16);
+            }
+            return ip;
+        }
+        std::vector<uint8_t> ip(4, 0);
+        if (addr.ss_family == AF_INET) {
+            memcpy(ip.data(), &reinterpret_cast<const sockaddr_in*>(&addr)->sin_addr, 4);
+        }
+        return ip;
+    }
+}
+
+Pcap_Writer::Pcap_Writer(const std::string &path, bool tcp, bool hosted) : tcp(tcp) 
+{
+    this->file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "ERROR: Cannot create capture file: " << path << "\n";
+        Toolkit::fail(ERR_INVALID, hosted);
+    }
+    Pcap_Header header = {PCAP_MAGIC_NS, 2, 4, 0, 0, PCAP_SNAPLEN, LINKTYPE_RAW};
+    fwrite(&header, sizeof(header), 1, file);
+}
+
+Pcap_Writer::~Pcap_Writer() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+void Pcap_Writer::write(bool outbound, const sockaddr_storage &local, const sockaddr_storage &peer,
+                        const uint8_t *data, size_t len) 
+{
+    const sockaddr_storage &src = outbound ? local : peer;
+    const sockaddr_storage &dst = outbound ? peer : local;
+    int family = peer.ss_family == AF_INET6 ? AF_INET6 : AF_INET;
+    size_t l4_len = (tcp ? 20 : 8) + len;
+
+    std::vector<uint8_t> pkt;
+    pkt.reserve(40 + l4_len);
+
+    if (family == AF_INET) {
+        put16(pkt, 0x4500); // version, header length, TOS
+        put16(pkt, 20 + l4_len);
+        put16(pkt, ip_id++);
+        put16(pkt, 0x4000); // don't fragment
+        pkt.push_back(64);
+        pkt.push_back(tcp ? IPPROTO_TCP : IPPROTO_UDP);
+        put16(pkt, 0); // checksum, filled below
+        auto s = ip_bytes(src, family), d = ip_bytes(dst, family);
+        pkt.insert(pkt.end(), s.begin(), s.end());
+        pkt.insert(pkt.end(), d.begin(), d.end());
+
+        uint32_t sum = 0;
+        for (size_t i = 0; i < 20; i += 2) sum += get16(&pkt[i]);
+        while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+        uint16_t csum = htons(~sum & 0xFFFF);
+        memcpy(&pkt[10], &csum, 2);
+    } else {
+        put32(pkt, 0x60000000);
+        put16(pkt, l4_len);
+        pkt.push_back(tcp ? IPPROTO_TCP : IPPROTO_UDP);
+        pkt.push_back(64);
+        auto s = ip_bytes(src, family), d = ip_bytes(dst, family);
+        pkt.insert(pkt.end(), s.begin(), s.end());
+        pkt.insert(pkt.end(), d.begin(), d.end());
+    }
+
+    put16(pkt, Toolkit::get_port(src));
+    put16(pkt, Toolkit::get_port(dst));
+    if (tcp) {
+        uint32_t &seq = outbound ? seq_out : seq_in;
+        put32(pkt, seq);
+        put32(pkt, outbound ? seq_in : seq_out);
+        put16(pkt, 0x5018); // header length 5 words, PSH ACK
+        put16(pkt, 65535);
+        put32(pkt, 0);      // checksum and urgent pointer
+        seq += len;
+    } else {
+        put16(pkt, l4_len);
+        put16(pkt, 0);      // no checksum
+    }
+    pkt.insert(pkt.end(), data, data + len);
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint32_t incl = std::min<size_t>(pkt.size(), PCAP_SNAPLEN);
+    Pcap_Record record = {(uint32_t)now.tv_sec, (uint32_t)now.tv_nsec, incl, (uint32_t)pkt.size()};
+    fwrite(&record, sizeof(record), 1, file);
+    fwrite(pkt.data(), 1, incl, file); // flushed by exit()
+}
+
+Pcap_Reader::Pcap_Reader(const std::string &path, bool tcp) : tcp(tcp) 
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "ERROR: Cannot open capture file: " << path << "\n";
+        exit(ERR_INVALID);
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Pcap_Header header;
+    if (data.size() < sizeof(header)) {
+        std::cerr << "ERROR: Not a pcap file: " << path << "\n";
+        exit(ERR_INVALID);
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    uint32_t magic = header.magic;
+    bool swap = magic == __builtin_bswap32(PCAP_MAGIC_NS) || magic == __builtin_bswap32(PCAP_MAGIC_US);
+    magic = swap32(magic, swap);
+    if (magic != PCAP_MAGIC_NS && magic != PCAP_MAGIC_US) {
+        std::cerr << "ERROR: Not a pcap file (pcapng is not supported): " << path << "\n";
+        exit(ERR_INVALID);
+    }
+    uint32_t link = swap32(header.network, swap);
+
+    size_t pos = sizeof(header);
+    while (pos + sizeof(Pcap_Record) <= data.size()) {
+        Pcap_Record record;
+        memcpy(&record, &data[pos], sizeof(record));
+        pos += sizeof(record);
+        size_t len = swap32(record.incl_len, swap);
+        if (pos + len > data.size()) break; // truncated capture
+        const uint8_t *pkt = &data[pos];
+        pos += len;
+
+        switch (link) {
+            case LINKTYPE_RAW:
+                parse_ip(pkt, len);
+                break;
+            case LINKTYPE_NULL:
+                if (len > 4) parse_ip(pkt + 4, len - 4);
+                break;
+            case LINKTYPE_ETHERNET: {
+                size_t off = 12;
+                if (len >= off + 2 && get16(pkt + off) == 0x8100) off += 4; // VLAN tag
+                if (len > off + 2) parse_ip(pkt + off + 2, len - off - 2);
+                break;
+            }
+            case LINKTYPE_LINUX_SLL:
+                if (len > 16) parse_ip(pkt + 16, len - 16);
+                break;
+            default:
+                std::cerr << "ERROR: Unsupported link type " << link << " in " << path << "\n";
+                exit(ERR_INVALID);
+        }
+    }
+    printf_debug("Read %zu payloads from %s", frames.size(), path.c_str());
+}
+
+const std::vector<Pcap_Frame>& Pcap_Reader::get_frames() const { return frames; }
+
+void Pcap_Reader::parse_ip(const uint8_t *pkt, size_t len) 
+{
+    if (len < 20) return;
+    uint8_t proto;
+    size_t ip_len, hdr_len, total;
+
+    if ((pkt[0] >> 4) == 4) {
+        hdr_len = (pkt[0] & 0x0F) * 4;
+        total = get16(pkt + 2);
+        if (get16(pkt + 6) & 0x3FFF) return; // fragments aren't reassembled
+        proto = pkt[9];
+        ip_len = 4;
+        pkt += 12;                           // addresses
+    } else if ((pkt[0] >> 4) == 6 && len >= 40) {
+        hdr_len = 40;                        // extension headers are not expected
+        total = 40 + get16(pkt + 4);
+        proto = pkt[6];
+        ip_len = 16;
+        pkt += 8;
+    } else {
+        return;
+    }
+    if (proto != (tcp ? IPPROTO_TCP : IPPROTO_UDP)) return;
+    total = std::min(total, len); // snaplen or padding
+    if (total <= hdr_len) return;
+
+    const uint8_t *src = pkt, *dst = pkt + ip_len;
+    const uint8_t *l4 = (ip_len == 4 ? pkt - 12 : pkt - 8) + hdr_len;
+    add_payload(src, dst, ip_len, l4, total - hdr_len);
+}
+
+void Pcap_Reader::add_payload(const uint8_t *src_ip, const uint8_t *dst_ip, size_t ip_len,
+                              const uint8_t *l4, size_t len) 
+{
+    size_t hdr = tcp ? 20 : 8;
+    if (len < hdr) return;
+    if (tcp) {
+        hdr = (l4[12] >> 4) * 4;
+        if (len < hdr) return;
+    }
+    uint16_t src_port = get16(l4), dst_port = get16(l4 + 2);
+    const uint8_t *payload = l4 + hdr;
+    size_t payload_len = len - hdr;
+    if (payload_len == 0) return; // handshake, ACKs
+
+    if (!have_client) {
+        have_client = true;
+        client_ip.assign(src_ip, src_ip + ip_len);
+        client_port = src_port;
+    }
+    auto is_client = [&](const uint8_t *ip, uint16_t port) {
+        return port == client_port && client_ip.size() == ip_len && memcmp(ip, client_ip.data(), ip_len) == 0;
+    };
+    bool inbound = is_client(dst_ip, dst_port);
+    if (!inbound && !is_client(src_ip, src_port)) return; // other connection
+
+    if (tcp && inbound) {
+        // retransmitted or overlapping segments are cut to what wasn't seen yet
+        uint32_t seq = get32(l4 + 4);
+        if (!have_seq_in) {
+            have_seq_in = true;
+            next_seq_in = seq;
+        }
+        uint32_t end = seq + payload_len;
+        if ((int32_t)(end - next_seq_in) <= 0) return;
+        if ((int32_t)(seq - next_seq_in) < 0) {
+            size_t skip = next_seq_in - seq;
+            payload += skip;
+            payload_len -= skip;
+        }
+        next_seq_in = end;
+    }
+    frames.push_back({inbound, std::vector<uint8_t>(payload, payload + payload_len)});
+}
@@ -0,0 +1,82 @@
+/**
+ * @file reorder_buffer.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "reorder_buffer.h"
+#include "tools.h"
+
+Reorder_Buffer::Reorder_Buffer(std::chrono::milliseconds max_wait) : max_wait(max_wait) {}
+
+uint32_t Reorder_Buffer::unwrap(uint16_t msg_id) const {
+    int16_t diff = static_cast<int16_t>(msg_id - static_cast<uint16_t>(expected));
+    return expected + diff;
+}
+
+void Reorder_Buffer::push(uint16_t msg_id, std::span<const uint8_t> pac, std::vector<Packet> &ready) 
+{
+    if (!started) {
+        started = true;
+        expected = msg_id + 0x10000; // room below for late ones
+    }
+    uint32_t seq = unwrap(msg_id);
+
+    if (seq < expected) { // its gap was skipped already
+        printf_debug("Late msg_id %d released", msg_id);
+        ready.emplace_back(pac.begin(), pac.end());
+        return;
+    }
+    held.emplace(seq, Held{Packet(pac.begin(), pac.end()), Clock::now()});
+    release(ready);
+
+    if (held.size() > REORDER_MAX_HELD) {
+        skip_gap(ready);
+    }
+}
+
+void Reorder_Buffer::release(std::vector<Packet> &ready) 
+{
+    auto it = held.begin();
+    while (it != held.end() && it->first == expected) {
+        ready.push_back(std::move(it->second.pac));
+        it = held.erase(it);
+        expected++;
+    }
+}
+
+void Reorder_Buffer::skip_gap(std::vector<Packet> &ready) 
+{
+    if (held.empty()) return;
+    uint32_t next = held.begin()->first;
+    printf_debug("Skipping msg_ids %u..%u", expected & 0xFFFF, (next - 1) & 0xFFFF);
+    skipped_ids += next - expected;
+    expected = next;
+    release(ready);
+}
+
+void Reorder_Buffer::expire(std::vector<Packet> &ready) 
+{
+    auto now = Clock::now();
+    while (!held.empty() && now - held.begin()->second.since >= max_wait) {
+        skip_gap(ready);
+    }
+}
+
+void Reorder_Buffer::flush(std::vector<Packet> &ready) 
+{
+    while (!held.empty()) {
+        skip_gap(ready);
+    }
+}
+
+std::optional<Reorder_Buffer::Clock::time_point> Reorder_Buffer::deadline() const 
+{
+    if (held.empty()) return std::nullopt;
+    return held.begin()->second.since + max_wait;
+}
+
+size_t Reorder_Buffer::skipped() const {
+    return skipped_ids;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file resolver_cache.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "resolver_cache.h"
+#include "tools.h"
+
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h> // getpid()
+#include <sys/stat.h> // mkdir()
+
+Resolver_Cache::Resolver_Cache(uint32_t ttl) : ttl(ttl) 
+{
+    const char *dir = getenv("XDG_CACHE_HOME");
+    if (dir && *dir) {
+        path = std::string(dir) + "/ipk25chat-resolv.cache";
+    } else if (const char *home = getenv("HOME")) {
+        path = std::string(home) + "/.cache/ipk25chat-resolv.cache";
+    }
+}
+
+std::vector<sockaddr_storage> Resolver_Cache::lookup(const std::string &host) 
+{
+    std::vector<sockaddr_storage> addrs;
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string name, ip;
+        long long expiry;
+        if (!(iss >> name >> expiry) || name != host) continue;
+
+        if (expiry < time(nullptr)) {
+            printf_debug("Cached address of %s expired", host.c_str());
+            return {};
+        }
+        while (iss >> ip) {
+            sockaddr_storage addr{};
+            if (Toolkit::parse_address(ip, addr)) {
+                addrs.push_back(addr);
+            }
+        }
+        printf_debug("Using %zu cached addresses of %s", addrs.size(), host.c_str());
+        break;
+    }
+    return addrs;
+}
+
+void Resolver_Cache::store(const std::string &host, const std::vector<sockaddr_storage> &addrs) 
+{
+    if (path.empty() || ttl == 0) return;
+
+    // keep entries of other hosts which haven't expired
+    std::ostringstream out;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string name;
+        long long expiry;
+        if (!(iss >> name >> expiry) || name == host || expiry < time(nullptr)) continue;
+        out << line << "\n";
+    }
+    file.close();
+
+    out << host << " " << time(nullptr) + ttl;
+    for (auto &addr : addrs) {
+        out << " " << Toolkit::address_to_string(addr);
+    }
+    out << "\n";
+
+    mkdir(path.substr(0, path.rfind('/')).c_str(), 0700); // ~/.cache may not exist yet
+
+    // replaced at once, concurrent clients never read half of the file
+    std::string tmp = path + "." + std::to_string(getpid());
+    std::ofstream tmp_file(tmp, std::ios::trunc);
+    if (!tmp_file) {
+        printf_debug("Cannot write resolver cache %s", tmp.c_str());
+        return;
+    }
+    tmp_file << out.str();
+    tmp_file.close();
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+    }
+}
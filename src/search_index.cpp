@@ -0,0 +1,177 @@
+/**
+ * @file search_index.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "search_index.h"
+
+#include <algorithm>
+#include <cctype>
+
+#define SENDER_PREFIX '\x01' // not a word character, senders and words don't mix
+
+size_t Search_Index::size() const { return docs.size(); }
+
+void Search_Index::add(std::string_view name, std::string_view content)
+{
+    size_t len = name.size() + content.size();
+    if (chunks.empty() || chunks.back().size() + len > chunks.back().capacity()) {
+        chunks.emplace_back();
+        chunks.back().reserve(std::max<size_t>(SEARCH_CHUNK, len));
+    }
+    std::string &chunk = chunks.back();
+    docs.push_back({static_cast<uint32_t>(chunks.size() - 1), static_cast<uint32_t>(chunk.size()),
+                    static_cast<uint32_t>(name.size()), static_cast<uint32_t>(content.size())});
+    chunk.append(name);
+    chunk.append(content);
+}
+
+std::string_view Search_Index::name(uint32_t doc) const
+{
+    const Doc &d = docs[doc];
+    return std::string_view(chunks[d.chunk]).substr(d.offset, d.name_len);
+}
+
+std::string_view Search_Index::content(uint32_t doc) const
+{
+    const Doc &d = docs[doc];
+    return std::string_view(chunks[d.chunk]).substr(d.offset + d.name_len, d.content_len);
+}
+
+/**
+ * @brief calls fn with every lowercase alphanumeric word of text
+ */
+template <typename F>
+void Search_Index::for_each_word(std::string_view text, F &&fn)
+{
+    char word[SEARCH_MAX_TOKEN];
+    size_t len = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        unsigned char c = i < text.size() ? text[i] : ' ';
+        if (std::isalnum(c)) {
+            if (len < SEARCH_MAX_TOKEN) word[len++] = std::tolower(c);
+            continue;
+        }
+        if (len > 0) {
+            fn(std::string_view(word, len));
+            len = 0;
+        }
+    }
+}
+
+void Search_Index::Postings::push(uint32_t doc)
+{
+    if (count > 0 && doc == last) return; // word repeated in the message
+    uint32_t gap = count > 0 ? doc - last : doc;
+    while (gap >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(gap) | 0x80);
+        gap >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(gap));
+    last = doc;
+    count++;
+}
+
+bool Search_Index::index_pending(size_t max_docs)
+{
+    std::string key;
+    for (; indexed < docs.size() && max_docs > 0; ++indexed, --max_docs) {
+        uint32_t doc = indexed;
+        for_each_word(content(doc), [&](std::string_view word) {
+            key.assign(word);
+            terms[key].push(doc); // the key is copied only for a new word
+        });
+        key.assign(1, SENDER_PREFIX);
+        key.append(name(doc));
+        terms[key].push(doc);
+    }
+    return indexed < docs.size();
+}
+
+std::vector<uint32_t> Search_Index::decode(const Postings &list)
+{
+    std::vector<uint32_t> out;
+    out.reserve(list.count);
+    uint32_t doc = 0;
+    size_t i = 0;
+    while (i < list.bytes.size()) {
+        uint32_t gap = 0;
+        for (int shift = 0; ; shift += 7) {
+            uint8_t b = list.bytes[i++];
+            gap |= uint32_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        doc = out.empty() ? gap : doc + gap;
+        out.push_back(doc);
+    }
+    return out;
+}
+
+/**
+ * @brief keeps the documents also in list, decoding it in one pass
+ */
+void Search_Index::intersect(std::vector<uint32_t> &docs, const Postings &list)
+{
+    size_t kept = 0, next = 0;
+    uint32_t doc = 0;
+    bool first = true;
+    size_t i = 0;
+    while (i < list.bytes.size() && next < docs.size()) {
+        uint32_t gap = 0;
+        for (int shift = 0; ; shift += 7) {
+            uint8_t b = list.bytes[i++];
+            gap |= uint32_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        doc = first ? gap : doc + gap;
+        first = false;
+
+        while (next < docs.size() && docs[next] < doc) next++;
+        if (next < docs.size() && docs[next] == doc) {
+            docs[kept++] = doc;
+            next++;
+        }
+    }
+    docs.resize(kept);
+}
+
+Search_Index::Result Search_Index::search(std::span<const std::string_view> query, size_t limit)
+{
+    index_pending(docs.size() - indexed); // everything received so far
+
+    std::vector<const Postings*> lists;
+    bool missing = false;
+    auto lookup = [&](const std::string &key) {
+        auto it = terms.find(key);
+        if (it == terms.end()) {
+            missing = true;
+        } else {
+            lists.push_back(&it->second);
+        }
+    };
+
+    for (std::string_view term : query) {
+        if (term.starts_with("from:") && term.size() > 5) {
+            lookup(SENDER_PREFIX + std::string(term.substr(5)));
+        } else {
+            for_each_word(term, [&](std::string_view word) { lookup(std::string(word)); });
+        }
+    }
+
+    Result result;
+    if (lists.empty() || missing) return result;
+
+    // shortest list first, the candidates only shrink
+    std::sort(lists.begin(), lists.end(), [](const Postings *a, const Postings *b) { return a->count < b->count; });
+    std::vector<uint32_t> matches = decode(*lists[0]);
+    for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+        intersect(matches, *lists[i]);
+    }
+
+    result.total = matches.size();
+    size_t from = matches.size() > limit ? matches.size() - limit : 0;
+    result.newest.assign(matches.begin() + from, matches.end());
+    return result;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file session_hub.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "session_hub.h"
+#include "client_session.h"
+#include "tools.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+Session_Hub::Session_Hub(const Client_Init &config) : config(config) {}
+
+Session_Hub::~Session_Hub() = default;
+
+bool Session_Hub::empty() const { return sessions.empty(); }
+bool Session_Hub::guest_active() const { return active != MAIN; }
+
+// stdout, unless it carries records (-o)
+std::ostream& Session_Hub::out() const
+{
+    return config.get_output() == Output_Mode::Text ? std::cout : std::cerr;
+}
+
+bool Session_Hub::is_hub_command(std::string_view line)
+{
+    std::string_view command = line.substr(0, line.find_first_of(" \t\r\n\v\f")); // as handle_command() splits it
+    return command == "/open" || command == "/switch";
+}
+
+template <typename F>
+void Session_Hub::call(size_t index, F &&fn)
+{
+    Entry &entry = sessions[index];
+    if (entry.closed) return;
+    try {
+        std::visit([&](auto &session) { fn(*session); }, entry.session);
+    } catch (const Session_Closed &closed) {
+        entry.closed = true;
+        std::cerr << "Session " << entry.name << " closed (" << closed.ex_code << ")\n";
+    }
+}
+
+void Session_Hub::prune()
+{
+    for (size_t i = sessions.size(); i-- > 0; ) {
+        if (!sessions[i].closed) continue;
+        if (active == i) {
+            active = MAIN;
+            std::cerr << "Switched to session " HUB_MAIN "\n";
+        } else if (active != MAIN && active > i) {
+            active--;
+        }
+        sessions.erase(sessions.begin() + i);
+    }
+}
+
+void Session_Hub::open(Args args)
+{
+    if (config.use_uring() || config.use_busy_poll()) {
+        out() << "ERROR: Sessions can't be opened with '-U' or '-P'.\n";
+        return;
+    }
+    if (args.size() != 4 || (args[1] != "tcp" && args[1] != "udp"))
+    {   // /open {name} tcp|udp {host} {port}
+        out() << "ERROR: Usage is /open <name> tcp|udp <host> <port>, try again.\n";
+        return;
+    }
+    std::string name(args[0]);
+    bool valid = name.size() <= HUB_NAME_MAX && name != HUB_MAIN
+                 && std::all_of(name.begin(), name.end(), [](unsigned char c) { return std::isalnum(c) || c == '-' || c == '_'; });
+    if (!valid) {
+        out() << "ERROR: Invalid session name, try again.\n";
+        return;
+    }
+    if (std::any_of(sessions.begin(), sessions.end(), [&](const Entry &e) { return e.name == name; })) {
+        out() << "ERROR: Session " << name << " is already open.\n";
+        return;
+    }
+    uint16_t port = 0;
+    auto [end, ec] = std::from_chars(args[3].data(), args[3].data() + args[3].size(), port);
+    if (ec != std::errc() || end != args[3].data() + args[3].size() || port == 0) {
+        out() << "ERROR: Invalid port, try again.\n";
+        return;
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.address = std::string(args[1]) + " " + std::string(args[2]) + ":" + std::to_string(port);
+    entry.config = std::make_unique<Client_Init>(config.for_session(name, std::string(args[1]), std::string(args[2]), port));
+    if (entry.config->is_tcp()) {
+        entry.session = std::make_unique<Client_Session<Tcp_Transport>>(*entry.config);
+    } else {
+        entry.session = std::make_unique<Client_Session<Udp_Transport>>(*entry.config);
+    }
+    sessions.push_back(std::move(entry));
+
+    size_t index = sessions.size() - 1;
+    call(index, [&](auto &session) {
+        session.comms->keep_process();
+        session.tag = name;
+        session.start();
+    });
+    if (sessions[index].closed) { // resolving or connecting failed
+        prune();
+        return;
+    }
+    active = index;
+    std::cerr << "Switched to session " << name << "\n";
+}
+
+void Session_Hub::switch_to(Args args)
+{
+    if (args.empty()) {
+        out() << (active == MAIN ? "* " : "  ") << HUB_MAIN << "\n";
+        for (size_t i = 0; i < sessions.size(); i++) {
+            out() << (active == i ? "* " : "  ") << sessions[i].name << " " << sessions[i].address << "\n";
+        }
+        return;
+    }
+    if (args.size() > 1) {
+        out() << "ERROR: Too many arguments, try again.\n";
+        return;
+    }
+    if (args[0] == HUB_MAIN) {
+        active = MAIN;
+    } else {
+        auto it = std::find_if(sessions.begin(), sessions.end(), [&](const Entry &e) { return e.name == args[0]; });
+        if (it == sessions.end()) {
+            out() << "ERROR: No session " << args[0] << ", see '/switch'.\n";
+            return;
+        }
+        active = it - sessions.begin();
+    }
+    std::cerr << "Switched to session " << args[0] << "\n";
+}
+
+std::optional<Session_Hub::Clock::time_point> Session_Hub::next_wake_up(std::optional<Clock::time_point> main)
+{
+    auto earliest = main;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        call(i, [&](auto &session) {
+            auto wake_up = session.next_wake_up();
+            if (wake_up && (!earliest || *wake_up < *earliest)) earliest = wake_up;
+        });
+    }
+    return earliest;
+}
+
+/**
+ * @brief one ppoll() over stdin and the descriptors of all sessions, ready opened
+ * sessions are remembered for receive()
+ */
+unsigned Session_Hub::wait(bool want_stdin, int main_fd, int doorbell_fd, std::optional<Clock::time_point> deadline)
+{
+    fds.clear();
+    fds.push_back({want_stdin ? STDIN_FILENO : -1, POLLIN, 0}); // negative fd is ignored
+    fds.push_back({main_fd, POLLIN, 0});
+    fds.push_back({doorbell_fd, POLLIN, 0});
+    for (auto &entry : sessions) {
+        int fd = -1;
+        std::visit([&](auto &session) { fd = session->event_fd(); }, entry.session);
+        fds.push_back({entry.closed ? -1 : fd, POLLIN, 0});
+        entry.ready = 0;
+    }
+
+    struct timespec ts, *timeout = nullptr;
+    uint32_t dumps = flight_recorder.dump_count();
+    int active_fds;
+    while (true) {
+        if (deadline) {
+            auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - Clock::now());
+            left = std::max(left, std::chrono::nanoseconds(0));
+            ts.tv_sec = left.count() / 1000000000;
+            ts.tv_nsec = left.count() % 1000000000;
+            timeout = &ts;
+        }
+        active_fds = ppoll(fds.data(), fds.size(), timeout, nullptr);
+        if (active_fds < 0 && errno == EINTR && flight_recorder.dump_count() != dumps) {
+            dumps = flight_recorder.dump_count(); // SIGUSR2 is no reason to stop waiting
+            continue;
+        }
+        break;
+    }
+    if (active_fds < 0 && errno == EINTR) {
+        return 0; // Ctrl+C, the caller checks stop_requested
+    }
+    if (active_fds < 0) {
+        perror("ppoll");
+        return READY_ERROR;
+    }
+
+    const short readable = POLLIN | POLLHUP | POLLERR; // as select() reports them
+    unsigned ready = 0;
+    if (fds[0].revents & readable) ready |= READY_STDIN;
+    if (fds[1].revents & readable) ready |= READY_SOCKET;
+    if (fds[2].revents & readable) ready |= READY_DOORBELL;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        if (fds[i + 3].revents & readable) sessions[i].ready = READY_SOCKET;
+    }
+    return ready;
+}
+
+void Session_Hub::receive()
+{
+    for (size_t i = 0; i < sessions.size(); i++) {
+        call(i, [&](auto &session) {
+            session.arena.reset();
+            session.receive(sessions[i].ready);
+        });
+    }
+    prune();
+}
+
+void Session_Hub::flush()
+{
+    for (size_t i = 0; i < sessions.size(); i++) {
+        call(i, [](auto &session) { session.flush(); });
+    }
+    prune();
+}
+
+bool Session_Hub::input_blocked()
+{
+    bool blocked = false;
+    call(active, [&](auto &session) { blocked = session.input_blocked(); });
+    return blocked;
+}
+
+void Session_Hub::handle_line(const std::string &line)
+{
+    call(active, [&](auto &session) {
+        session.arena.reset();
+        session.handle_line(line);
+    });
+    prune();
+}
+
+void Session_Hub::close_all()
+{
+    active = MAIN; // stdin is not read anymore
+    for (size_t i = 0; i < sessions.size(); i++) {
+        call(i, [](auto &session) { session.graceful_exit(0); }); // always ends in Session_Closed
+    }
+    prune();
+}
@@ -0,0 +1,206 @@
+/**
+ * @file shm_ring.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "shm_ring.h"
+#include "tools.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#define SHM_MAGIC "IPKR"
+#define SHM_VERSION 1
+
+Shm_Ring::Shm_Ring(const std::string &name, char *map)
+    : bell_path("/dev/shm/" + name + ".bell"), map(map)
+{
+    header = reinterpret_cast<Header*>(map);
+    slots = reinterpret_cast<Slot*>(map + SLOTS_OFFSET);
+    completions = reinterpret_cast<Completion*>(map + COMPLETIONS_OFFSET);
+}
+
+Shm_Ring::~Shm_Ring()
+{
+    if (bell != -1) {
+        close(bell);
+    }
+    munmap(map, MAP_SIZE);
+}
+
+std::unique_ptr<Shm_Ring> Shm_Ring::create(const std::string &name)
+{
+    std::string object = "/" + name;
+    int fd = shm_open(object.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        perror("ERROR: shm_open");
+        exit(ERR_INVALID);
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    bool fresh = static_cast<size_t>(st.st_size) != MAP_SIZE;
+    if (fresh && ftruncate(fd, MAP_SIZE) != 0) {
+        perror("ERROR: ftruncate");
+        exit(ERR_INTERNAL);
+    }
+    void *addr = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // mapping stays valid
+    if (addr == MAP_FAILED) {
+        perror("ERROR: mmap");
+        exit(ERR_INTERNAL);
+    }
+    std::unique_ptr<Shm_Ring> ring(new Shm_Ring(name, static_cast<char*>(addr)));
+    Header *h = ring->header;
+
+    if (fresh || memcmp(h->magic, SHM_MAGIC, 4) != 0 || h->version != SHM_VERSION) {
+        memset(ring->map, 0, SLOTS_OFFSET);
+        h->version = SHM_VERSION;
+        h->slots = SHM_RING_SLOTS;
+        h->slot_size = SHM_SLOT_SIZE;
+        for (uint64_t i = 0; i < SHM_RING_SLOTS; i++) {
+            ring->slots[i].seq.store(i, std::memory_order_relaxed);
+            ring->completions[i].ticket.store(0, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(h->magic, SHM_MAGIC, 4); // producers attach from here on
+    }
+    ring->tail = h->tail.load(std::memory_order_relaxed); // messages left by an earlier run are sent
+
+    if (mkfifo(ring->bell_path.c_str(), 0600) != 0 && errno != EEXIST) {
+        perror("ERROR: mkfifo");
+        exit(ERR_INTERNAL);
+    }
+    ring->bell = open(ring->bell_path.c_str(), O_RDWR | O_NONBLOCK); // never sees EOF
+    if (ring->bell < 0) {
+        perror("ERROR: open doorbell");
+        exit(ERR_INTERNAL);
+    }
+    printf_debug("Ring %s: %lu messages waiting", object.c_str(),
+                 static_cast<unsigned long>(h->head.load() - ring->tail));
+    return ring;
+}
+
+std::unique_ptr<Shm_Ring> Shm_Ring::attach(const std::string &name)
+{
+    std::string object = "/" + name;
+    int fd = shm_open(object.c_str(), O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    fstat(fd, &st);
+    if (static_cast<size_t>(st.st_size) != MAP_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+    void *addr = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<Shm_Ring> ring(new Shm_Ring(name, static_cast<char*>(addr)));
+    if (memcmp(ring->header->magic, SHM_MAGIC, 4) != 0 || ring->header->version != SHM_VERSION) {
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return ring;
+}
+
+// producer side
+std::optional<uint64_t> Shm_Ring::post(std::string_view content)
+{
+    if (content.size() > sizeof(Slot::data)) return std::nullopt;
+
+    uint64_t ticket = header->head.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &slots[ticket & (SHM_RING_SLOTS - 1)];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq - ticket);
+        if (diff == 0) {
+            if (header->head.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return std::nullopt; // full, the client hasn't freed this slot yet
+        } else {
+            ticket = header->head.load(std::memory_order_relaxed); // claimed by another producer
+        }
+    }
+    memcpy(slot->data, content.data(), content.size());
+    slot->length = static_cast<uint32_t>(content.size());
+    slot->seq.store(ticket + 1, std::memory_order_release);
+
+    // pairs with the fence in sleep(), either the client sees the message or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header->sleeping.load(std::memory_order_relaxed) && header->sleeping.exchange(0)) {
+        ring();
+    }
+    return ticket;
+}
+
+Shm_Status Shm_Ring::status(uint64_t ticket) const
+{
+    const Completion &done = completions[ticket & (SHM_RING_SLOTS - 1)];
+    uint64_t completed = done.ticket.load(std::memory_order_acquire);
+    if (completed < ticket + 1) return Shm_Status::Pending;
+    if (completed > ticket + 1) return Shm_Status::Expired;
+    return static_cast<Shm_Status>(done.status);
+}
+
+void Shm_Ring::ring()
+{
+    if (bell == -1) {
+        bell = open(bell_path.c_str(), O_WRONLY | O_NONBLOCK); // ENXIO if the client is gone
+        if (bell == -1) return;
+    }
+    char byte = 1;
+    if (write(bell, &byte, 1) < 0 && errno != EAGAIN) { // a full FIFO wakes the client as well
+        close(bell);
+        bell = -1;
+    }
+}
+
+// client side
+int Shm_Ring::doorbell_fd() const
+{
+    return bell;
+}
+
+bool Shm_Ring::sleep()
+{
+    header->sleeping.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::string_view content;
+    if (peek(content)) {
+        header->sleeping.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void Shm_Ring::wake(bool rung)
+{
+    header->sleeping.store(0, std::memory_order_relaxed);
+    if (!rung) return;
+    char drain[64];
+    while (read(bell, drain, sizeof(drain)) > 0) {}
+}
+
+bool Shm_Ring::peek(std::string_view &content) const
+{
+    const Slot &slot = slots[tail & (SHM_RING_SLOTS - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != tail + 1) return false;
+    content = std::string_view(slot.data, std::min<size_t>(slot.length, sizeof(Slot::data)));
+    return true;
+}
+
+void Shm_Ring::pop(Shm_Status status)
+{
+    size_t index = tail & (SHM_RING_SLOTS - 1);
+    Completion &done = completions[index];
+    done.status = static_cast<uint32_t>(status);
+    done.ticket.store(tail + 1, std::memory_order_release);
+
+    slots[index].seq.store(tail + SHM_RING_SLOTS, std::memory_order_release); // free for ticket + SHM_RING_SLOTS
+    tail++;
+    header->tail.store(tail, std::memory_order_relaxed);
+}
@@ -0,0 +1,240 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <bit> // std::countr_zero
+
+Timer_Wheel::Timer_Wheel() : origin(Clock::now())
+{
+    for (auto &level : heads) {
+        std::fill(std::begin(level), std::end(level), NIL);
+    }
+}
+
+size_t Timer_Wheel::size() const { return armed_count; }
+
+uint64_t Timer_Wheel::to_tick(Clock::time_point when) const
+{
+    auto d = std::chrono::duration_cast<std::chrono::nanoseconds>(when - origin).count();
+    if (d <= 0) return 0;
+    int64_t tick_ns = std::chrono::nanoseconds(WHEEL_TICK).count();
+    return (d + tick_ns - 1) / tick_ns;
+}
+
+Timer_Wheel::Id Timer_Wheel::schedule(Clock::time_point when, Callback fn)
+{
+    uint32_t index;
+    if (free_head != NIL) {
+        index = free_head;
+        free_head = nodes[index].next;
+    } else {
+        index = nodes.size();
+        nodes.emplace_back();
+    }
+    Node &n = nodes[index];
+    n.tick = to_tick(when);
+    n.fn = std::move(fn);
+    n.armed = true;
+    armed_count++;
+    place(index);
+    return {index, n.generation};
+}
+
+bool Timer_Wheel::pending(Id id) const
+{
+    return id.index < nodes.size() && nodes[id.index].armed
+           && nodes[id.index].generation == id.generation;
+}
+
+bool Timer_Wheel::cancel(Id id)
+{
+    if (!pending(id)) return false;
+    unlink(id.index);
+    release(id.index);
+    return true;
+}
+
+void Timer_Wheel::reschedule(Id &id, Clock::time_point when, Callback fn)
+{
+    if (!pending(id)) {
+        id = schedule(when, std::move(fn));
+        return;
+    }
+    Node &n = nodes[id.index];
+    unlink(id.index);
+    n.tick = to_tick(when);
+    n.fn = std::move(fn);
+    place(id.index);
+}
+
+Timer_Wheel::Clock::time_point Timer_Wheel::expiry(Id id) const {
+    return origin + nodes[id.index].tick * WHEEL_TICK;
+}
+
+/**
+ * @brief lowest level whose window (the bits above it) is shared with base,
+ * timers beyond the top level wait in its last slot and are placed again from there
+ */
+void Timer_Wheel::place(uint32_t index)
+{
+    Node &n = nodes[index];
+    uint64_t top = base | ((uint64_t(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1);
+    uint64_t t = std::min(std::max(n.tick, base), top);
+
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1
+           && (t >> (WHEEL_BITS * (level + 1))) != (base >> (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    uint32_t slot = (t >> (WHEEL_BITS * level)) & (SLOTS - 1);
+
+    n.level = level;
+    n.slot = slot;
+    n.prev = NIL;
+    n.next = heads[level][slot];
+    if (n.next != NIL) {
+        nodes[n.next].prev = index;
+    }
+    heads[level][slot] = index;
+    occupied[level] |= uint64_t(1) << slot;
+}
+
+void Timer_Wheel::unlink(uint32_t index)
+{
+    Node &n = nodes[index];
+    if (n.prev != NIL) {
+        nodes[n.prev].next = n.next;
+    } else {
+        heads[n.level][n.slot] = n.next;
+    }
+    if (n.next != NIL) {
+        nodes[n.next].prev = n.prev;
+    }
+    if (heads[n.level][n.slot] == NIL) {
+        occupied[n.level] &= ~(uint64_t(1) << n.slot);
+    }
+}
+
+void Timer_Wheel::release(uint32_t index)
+{
+    Node &n = nodes[index];
+    n.armed = false;
+    n.generation++;
+    n.fn = nullptr;
+    n.next = free_head;
+    free_head = index;
+    armed_count--;
+}
+
+/**
+ * @brief first slot of the level that may hold timers, a higher slot whose start
+ * base has reached (only when advance() stopped right there) is not cascaded yet
+ */
+uint32_t Timer_Wheel::first_slot(int level) const
+{
+    int shift = WHEEL_BITS * level;
+    uint32_t current = (base >> shift) & (SLOTS - 1);
+    bool at_start = (base & ((uint64_t(1) << shift) - 1)) == 0;
+    return (level == 0 || at_start) ? current : current + 1;
+}
+
+/**
+ * @brief first tick at which a level 0 slot fires or a higher slot is cascaded,
+ * slots of higher levels ahead of base in their window only
+ */
+uint64_t Timer_Wheel::next_event() const
+{
+    uint64_t best = UINT64_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        int shift = WHEEL_BITS * level;
+        uint32_t from = first_slot(level);
+        if (from >= SLOTS) continue;
+
+        uint64_t bits = occupied[level] & (~uint64_t(0) << from);
+        if (!bits) continue;
+        uint64_t window = (base >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS);
+        best = std::min(best, window | (uint64_t(std::countr_zero(bits)) << shift));
+    }
+    return best;
+}
+
+std::optional<Timer_Wheel::Clock::time_point> Timer_Wheel::next_expiry() const
+{
+    if (armed_count == 0) return std::nullopt;
+
+    uint64_t best = UINT64_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        uint32_t from = first_slot(level);
+        if (from >= SLOTS) continue;
+
+        uint64_t bits = occupied[level] & (~uint64_t(0) << from);
+        if (!bits) continue;
+        uint32_t slot = std::countr_zero(bits);
+        if (level == 0) {
+            uint64_t window = (base >> WHEEL_BITS) << WHEEL_BITS;
+            best = std::min(best, window | slot);
+            continue;
+        }
+        // earliest timer of the slot, it is cascaded before it fires
+        for (uint32_t i = heads[level][slot]; i != NIL; i = nodes[i].next) {
+            best = std::min(best, nodes[i].tick);
+        }
+    }
+    return origin + best * WHEEL_TICK;
+}
+
+size_t Timer_Wheel::advance(Clock::time_point now)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - origin).count();
+    if (elapsed < 0) return 0;
+    uint64_t target = elapsed / std::chrono::nanoseconds(WHEEL_TICK).count();
+
+    size_t fired = 0;
+    while (true) {
+        uint64_t next = next_event();
+        if (next > target) break;
+        base = next;
+
+        // top down, a cascaded timer may land in a lower slot starting at base as well
+        for (int level = WHEEL_LEVELS - 1; level >= 1; --level) {
+            if (base & ((uint64_t(1) << (WHEEL_BITS * level)) - 1)) continue;
+            uint32_t slot = (base >> (WHEEL_BITS * level)) & (SLOTS - 1);
+            while (heads[level][slot] != NIL) {
+                uint32_t index = heads[level][slot];
+                unlink(index);
+                place(index);
+            }
+        }
+
+        uint32_t slot = base & (SLOTS - 1);
+        uint32_t carried = NIL; // beyond the top level, placed again in the next window
+        while (heads[0][slot] != NIL) {
+            uint32_t index = heads[0][slot];
+            unlink(index);
+            if (nodes[index].tick > base) {
+                nodes[index].next = carried;
+                carried = index;
+                continue;
+            }
+            // released first, the callback may schedule or cancel timers
+            Callback fn = std::move(nodes[index].fn);
+            release(index);
+            fired++;
+            if (fn) fn();
+        }
+        base++;
+        while (carried != NIL) {
+            uint32_t index = carried;
+            carried = nodes[index].next;
+            place(index);
+        }
+    }
+    base = std::max(base, target + 1);
+    return fired;
+}
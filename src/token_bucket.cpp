@@ -0,0 +1,64 @@
+/**
+ * @file token_bucket.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "token_bucket.h"
+#include "tools.h"
+
+#include <algorithm>
+
+Token_Bucket::Token_Bucket(double rate, double burst)
+    : rate(rate), burst(burst), current(rate), tokens(burst), last(Clock::now()) {}
+
+void Token_Bucket::refill(Clock::time_point now) 
+{
+    double elapsed = std::chrono::duration<double>(now - last).count();
+    if (elapsed <= 0) return;
+    last = now;
+    if (current < rate) {
+        current = std::min(rate, current + rate * PACER_RECOVERY * elapsed);
+    }
+    tokens = std::min(burst, tokens + current * elapsed);
+}
+
+bool Token_Bucket::ready(Clock::time_point now) 
+{
+    refill(now);
+    return tokens >= 1;
+}
+
+void Token_Bucket::take() 
+{
+    tokens -= 1;
+}
+
+Token_Bucket::Clock::time_point Token_Bucket::ready_at() const 
+{
+    if (tokens >= 1) return last;
+    auto wait = std::chrono::duration<double>((1 - tokens) / current);
+    return last + std::chrono::ceil<Clock::duration>(wait);
+}
+
+void Token_Bucket::back_off(Clock::time_point now) 
+{
+    if (losses > 0 && now - last_loss < std::chrono::milliseconds(PACER_HOLD_MS)) return;
+    refill(now);
+    losses++;
+    last_loss = now;
+    current = std::max(rate / PACER_FLOOR, current / 2);
+    tokens = std::min(tokens, 0.0); // the burst is spent, resume at the lower rate
+    printf_debug("Pacing backed off to %.1f msg/s", current);
+}
+
+double Token_Bucket::current_rate() const 
+{
+    return current;
+}
+
+size_t Token_Bucket::back_offs() const 
+{
+    return losses;
+}
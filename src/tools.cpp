@@ -7,6 +7,18 @@
 
 #include "tools.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void Toolkit::fail(int ex_code, bool hosted) 
+{
+    if (hosted) {
+        throw Session_Closed{ex_code}; // the other sessions keep running
+    }
+    exit(ex_code);
+}
+
 int Toolkit::catch_stoi(const std::string &str, int size, const std::string &flag) 
 {
     try {
@@ -23,25 +35,120 @@ int Toolkit::catch_stoi(const std::string &str, int size, const std::string &fla
     }
 }
 
-bool Toolkit::only_allowed_chars(const std::string &str, const std::string &regex) 
+bool Toolkit::only_allowed_chars(std::string_view str) 
+{
+    // no std::regex_match, same reason as below
+    if (str.empty()) return false;
+    for (unsigned char c : str) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                  || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool Toolkit::only_printable_chars(std::string_view str, bool allow_space_and_lf) 
+{
+    // no std::regex_match, it allocates its match state on every call
+    return first_unprintable(str, allow_space_and_lf) == str.size();
+}
+
+size_t Toolkit::first_unprintable(std::string_view str, bool allow_space_and_lf) 
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    // signed compares, bytes >= 0x80 are negative and fail the lower bound
+    const __m128i above = _mm_set1_epi8(0x20);
+    const __m128i below = _mm_set1_epi8(0x7F);
+    const __m128i space = _mm_set1_epi8(allow_space_and_lf ? 0x20 : 0x21);
+    const __m128i lf = _mm_set1_epi8(allow_space_and_lf ? 0x0A : 0x21);
+    for (; i + 16 <= str.size(); i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str.data() + i));
+        __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(chunk, above), _mm_cmplt_epi8(chunk, below));
+        ok = _mm_or_si128(ok, _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, lf)));
+        int bad = ~_mm_movemask_epi8(ok) & 0xFFFF;
+        if (bad != 0) return i + __builtin_ctz(bad);
+    }
+#endif
+    for (; i < str.size(); i++) {
+        unsigned char c = str[i];
+        bool ok = (c >= 0x21 && c <= 0x7E) 
+                  || (allow_space_and_lf && (c == 0x20 || c == 0x0A));
+        if (!ok) return i;
+    }
+    return i;
+}
+
+std::string_view Toolkit::sanitize(std::string_view str, bool allow_space_and_lf, std::string &scratch) 
+{
+    size_t bad = first_unprintable(str, allow_space_and_lf);
+    if (bad == str.size()) return str; // the usual case, nothing is copied
+
+    static const char hex[] = "0123456789abcdef";
+    scratch.clear();
+    size_t from = 0;
+    while (bad < str.size()) {
+        unsigned char c = str[bad];
+        scratch.append(str.data() + from, bad - from);
+        scratch += "\\x";
+        scratch += hex[c >> 4];
+        scratch += hex[c & 0xF];
+        from = bad + 1;
+        bad = from + first_unprintable(str.substr(from), allow_space_and_lf);
+    }
+    scratch.append(str.data() + from, str.size() - from);
+    return scratch;
+}
+
+bool Toolkit::parse_address(const std::string &ip, sockaddr_storage &addr) 
+{
+    addr = {};
+    auto v4 = reinterpret_cast<sockaddr_in*>(&addr);
+    auto v6 = reinterpret_cast<sockaddr_in6*>(&addr);
+    if (inet_pton(AF_INET, ip.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        return true;
+    }
+    return false;
+}
+
+std::string Toolkit::address_to_string(const sockaddr_storage &addr) 
 {
-    const std::regex pattern(regex);
-    return std::regex_match(str, pattern);
+    char buf[INET6_ADDRSTRLEN] = "";
+    if (addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&addr)->sin_addr, buf, sizeof(buf));
+    } else if (addr.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_addr, buf, sizeof(buf));
+    }
+    return buf;
+}
+
+socklen_t Toolkit::address_len(const sockaddr_storage &addr) {
+    return addr.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
 }
 
-bool Toolkit::only_printable_chars(const std::string &str, bool allow_space_and_lf) 
+void Toolkit::set_port(sockaddr_storage &addr, uint16_t port) 
 {
-    if (allow_space_and_lf) {
-        static const std::regex pattern("^[\\x0A\\x20-\\x7E]*$");
-        return std::regex_match(str, pattern);
+    if (addr.ss_family == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port = htons(port);
     } else {
-        static const std::regex pattern("^[\\x21-\\x7E]*$");
-        return std::regex_match(str, pattern);
+        reinterpret_cast<sockaddr_in*>(&addr)->sin_port = htons(port);
     }
 }
 
+uint16_t Toolkit::get_port(const sockaddr_storage &addr) 
+{
+    if (addr.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_port);
+    }
+    return ntohs(reinterpret_cast<const sockaddr_in*>(&addr)->sin_port);
+}
 
-void Toolkit::append_uint8(std::vector<uint8_t>& buf, uint8_t value) 
+void Toolkit::append_uint8(Bytes& buf, uint8_t value) 
 {
     buf.push_back(value);
 }
@@ -49,31 +156,39 @@ void Toolkit::append_uint8(std::vector<uint8_t>& buf, uint8_t value)
 /**
  * @brief function to spread 2bytes into vector<uint8_t> in network byte order
  */
-void Toolkit::append_uint16(std::vector<uint8_t>& buf, uint16_t value) 
+void Toolkit::append_uint16(Bytes& buf, uint16_t value) 
 {
     uint16_t net = htons(value);
     auto ptr = reinterpret_cast<uint8_t*>(&net);
     buf.push_back(ptr[0]);
     buf.push_back(ptr[1]);
 }
-void Toolkit::append_string(std::vector<uint8_t>& buf, const std::string& s) 
+void Toolkit::append_string(Bytes& buf, std::string_view s) 
 {
     buf.insert(buf.end(), s.begin(), s.end());
     buf.push_back(0); // null terminator
 }
 
-std::vector<uint8_t> Toolkit::build_confirm (uint16_t ref_msg_id) 
+std::string_view Toolkit::read_string(std::span<const uint8_t> buf, size_t pos) 
+{
+    if (pos >= buf.size()) return {};
+    size_t end = pos;
+    while (end < buf.size() && buf[end] != 0x00) end++;
+    return {reinterpret_cast<const char*>(buf.data()) + pos, end - pos};
+}
+
+Toolkit::Bytes Toolkit::build_confirm (uint16_t ref_msg_id, std::pmr::memory_resource *mr) 
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0x00);
     append_uint16(packet, ref_msg_id);
     return packet;
 }
 
-std::vector<uint8_t> Toolkit::build_reply (uint16_t msg_id, 
-    uint8_t result, uint16_t ref_msg_id, const std::string& msg_contents)
+Toolkit::Bytes Toolkit::build_reply (uint16_t msg_id, 
+    uint8_t result, uint16_t ref_msg_id, std::string_view msg_contents, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0x01);
     append_uint16(packet, msg_id);
     append_uint8(packet, result);
@@ -82,11 +197,11 @@ std::vector<uint8_t> Toolkit::build_reply (uint16_t msg_id,
     return packet;
 }
 
-std::vector<uint8_t> Toolkit::build_auth (uint16_t msg_id, 
-    const std::string& username, const std::string& display_name, 
-    const std::string& secret)
+Toolkit::Bytes Toolkit::build_auth (uint16_t msg_id, 
+    std::string_view username, std::string_view display_name, 
+    std::string_view secret, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0x02);
     append_uint16(packet, msg_id);
     append_string(packet, username);
@@ -95,11 +210,11 @@ std::vector<uint8_t> Toolkit::build_auth (uint16_t msg_id,
     return packet;   
 }
 
-std::vector<uint8_t> Toolkit::build_join (
-    uint16_t msg_id, const std::string& channel_id, 
-    const std::string& display_name)
+Toolkit::Bytes Toolkit::build_join (
+    uint16_t msg_id, std::string_view channel_id, 
+    std::string_view display_name, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0x03);
     append_uint16(packet, msg_id);
     append_string(packet, channel_id);
@@ -111,11 +226,11 @@ std::vector<uint8_t> Toolkit::build_join (
  * @brief function to put data in vector<uint8_t>
  * @param is_error if true, replaces msg_type with err type
  */
-std::vector<uint8_t> Toolkit::build_msg (
-    uint16_t msg_id, const std::string& display_name,
-    const std::string& msg_contents, bool is_error)
+Toolkit::Bytes Toolkit::build_msg (
+    uint16_t msg_id, std::string_view display_name,
+    std::string_view msg_contents, bool is_error, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
 
     append_uint8(packet, is_error ? 0xFE : 0x04);
     append_uint16(packet, msg_id);
@@ -124,18 +239,18 @@ std::vector<uint8_t> Toolkit::build_msg (
     return packet;
 }
 
-std::vector<uint8_t> Toolkit::build_ping (uint16_t msg_id)
+Toolkit::Bytes Toolkit::build_ping (uint16_t msg_id, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0xFD);
     append_uint16(packet, msg_id);
     return packet;
     
 }
-std::vector<uint8_t> Toolkit::build_bye  (uint16_t msg_id, 
-    const std::string& display_name)
+Toolkit::Bytes Toolkit::build_bye  (uint16_t msg_id, 
+    std::string_view display_name, std::pmr::memory_resource *mr)
 {
-    std::vector<uint8_t> packet;
+    Bytes packet(mr);
     append_uint8(packet, 0xFF);
     append_uint16(packet, msg_id);
     append_string(packet, display_name);
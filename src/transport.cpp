@@ -0,0 +1,46 @@
+/**
+ * @file transport.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "transport.h"
+
+std::optional<ParsedMessage> Tcp_Transport::parse(std::string_view msg) 
+{
+    printf_debug("Parsing message: %.*s", (int)msg.size(), msg.data());
+
+    ParsedMessage result;
+
+    if (msg.starts_with("REPLY OK IS ") || msg.starts_with("REPLY NOK IS ")) {
+        bool is_ok = msg.starts_with("REPLY OK IS ");
+        result.type = is_ok ? "REPLY OK" : "REPLY NOK";
+        size_t prefix_len = is_ok ? strlen("REPLY OK IS ") : strlen("REPLY NOK IS ");
+        result.content = msg.substr(prefix_len);
+
+    } else if (msg.starts_with("MSG FROM ")) {
+        result.type = "MSG";
+        size_t from_pos = strlen("MSG FROM ");
+        size_t is_pos = msg.find(" IS ", from_pos);
+        if (is_pos != std::string_view::npos) {
+            result.display_name = msg.substr(from_pos, is_pos - from_pos);
+            result.content = msg.substr(is_pos + 4);
+        }
+
+    } else if (msg.starts_with("ERR FROM ")) {
+        result.type = "ERR";
+        size_t from_pos = strlen("ERR FROM ");
+        size_t is_pos = msg.find(" IS ", from_pos);
+        if (is_pos != std::string_view::npos) {
+            result.display_name = msg.substr(from_pos, is_pos - from_pos);
+            result.content = msg.substr(is_pos + 4);
+        }
+
+    } else if (msg.starts_with("BYE FROM ")) {
+        result.type = "BYE";
+        result.display_name = msg.substr(strlen("BYE FROM "));
+    }
+
+    return result;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file transport_probe.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "transport_probe.h"
+#include "client_comms.h"
+#include "transport.h"
+#include "tools.h"
+
+#include <thread>
+#include <optional>
+
+Transport_Probe::Transport_Probe(const Client_Init &config) : config(config) {}
+
+std::string Transport_Probe::run() 
+{
+    std::thread tcp_thread(&Transport_Probe::probe_tcp, this);
+    probe_udp();
+    tcp_thread.join();
+
+    bool use_udp;
+    if (!tcp.reached || !udp.reached) {
+        use_udp = udp.reached; // neither, TCP reports it
+    } else if (udp.lost > 0) {
+        use_udp = false;
+    } else {
+        use_udp = udp.rtt < tcp.rtt * PROBE_MARGIN;
+    }
+    if (use_udp && tcp_socket != -1) {
+        close(tcp_socket); // nothing was sent on it
+        tcp_socket = -1;
+    }
+
+    std::cerr << "Transport: " << (use_udp ? "udp" : "tcp") << " (tcp ";
+    if (tcp.reached) std::cerr << tcp.rtt.count() << " ms"; else std::cerr << "failed";
+    std::cerr << ", udp ";
+    if (udp.reached) std::cerr << udp.rtt.count() << " ms, "; else std::cerr << "failed, ";
+    std::cerr << udp.lost << "/" << PROBE_ATTEMPTS << " lost)\n";
+    return use_udp ? "udp" : "tcp";
+}
+
+int Transport_Probe::get_socket() const 
+{
+    return tcp_socket;
+}
+
+void Transport_Probe::probe_tcp() 
+{
+    Client_Comms comms(config.get_hostname(), true, config.get_port(), config.get_timeout());
+    comms.keep_process(); // a failed lookup throws instead of exiting
+    try {
+        if (config.get_cache_ttl() > 0) {
+            comms.set_resolver_cache(config.get_cache_ttl());
+        }
+        comms.resolve_ip();
+        auto start = std::chrono::steady_clock::now();
+        tcp_socket = comms.race_connect(); // not reported, UDP may still get through
+        tcp.rtt = std::chrono::steady_clock::now() - start;
+        tcp.reached = tcp_socket != -1;
+    } catch (const Session_Closed&) {
+        printf_debug("TCP probe failed");
+    }
+}
+
+void Transport_Probe::probe_udp() 
+{
+    using Clock = std::chrono::steady_clock;
+    Client_Comms comms(config.get_hostname(), false, config.get_port(), config.get_timeout());
+    comms.keep_process();
+    try {
+        comms.resolve_ip(); // the TCP thread fills the cache, if there is one
+        comms.connect_set();
+    } catch (const Session_Closed&) {
+        udp.lost = PROBE_ATTEMPTS;
+        return;
+    }
+
+    // only the server sends PING, so the probe is a BYE, which a client may send in any
+    // state, retransmitted with the same msg_id until its CONFIRM arrives
+    auto bye = Toolkit::build_bye(PROBE_MSG_ID, "probe");
+    for (int attempt = 0; attempt < PROBE_ATTEMPTS && !udp.reached; attempt++) {
+        auto sent = Clock::now();
+        auto deadline = sent + std::chrono::milliseconds(config.get_timeout());
+        comms.send_udp_message(bye);
+        while (auto reply = comms.timed_udp_reply(deadline)) {
+            if (reply->size() < 3) continue;
+            uint16_t msg_id = Udp_Transport::get_msg_id(*reply);
+            if (Udp_Transport::get_type(*reply) != 0x00) {
+                comms.send_udp_message(Toolkit::build_confirm(msg_id)); // e.g. ERR, not retransmitted to a closed port
+            } else if (msg_id == PROBE_MSG_ID) {
+                udp.rtt = Clock::now() - sent; // a retransmission's CONFIRM may answer an earlier one, UDP loses anyway
+                udp.reached = true;
+                break;
+            }
+        }
+        if (!udp.reached) udp.lost++;
+    }
+}
@@ -0,0 +1,198 @@
+/**
+ * @file uring.cpp
+ * @brief IPK project 2 - Client for a chat server
+ * @date 18-10-2026
+ * Author: Jaroslav Mervart, xmervaj00
+*/
+
+#include "uring.h"
+#include "tools.h"
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <algorithm>
+
+std::unique_ptr<Uring> Uring::create(unsigned buf_size) 
+{
+    std::unique_ptr<Uring> ring(new Uring());
+    if (!ring->setup() || !ring->setup_buffers(buf_size)) {
+        return nullptr;
+    }
+    return ring;
+}
+
+Uring::~Uring() {
+    if (buf_ring) munmap(buf_ring, buf_ring_size);
+    if (sqes) munmap(sqes, sqes_size);
+    if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+    if (sq_ptr) munmap(sq_ptr, sq_size);
+    if (ring_fd >= 0) close(ring_fd);
+}
+
+bool Uring::setup() 
+{
+    io_uring_params params{};
+    ring_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring_fd < 0) {
+        printf_debug("io_uring_setup: %s", strerror(errno));
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG)) { // needed for timed waits
+        printf_debug("io_uring is too old");
+        return false;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        sq_ptr = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            return false;
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQES);
+    if (sqes_ptr == MAP_FAILED) {
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    auto sq = static_cast<uint8_t*>(sq_ptr);
+    sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    sqe_tail = *sq_tail;
+
+    auto cq = static_cast<uint8_t*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool Uring::setup_buffers(unsigned buf_size) 
+{
+    this->buf_size = buf_size;
+    buf_ring_size = URING_BUF_COUNT * sizeof(io_uring_buf);
+    void *ptr = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    buf_ring = static_cast<io_uring_buf_ring*>(ptr);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        printf_debug("IORING_REGISTER_PBUF_RING: %s", strerror(errno));
+        return false;
+    }
+
+    buf_pool.resize(URING_BUF_COUNT * buf_size);
+    for (uint16_t bid = 0; bid < URING_BUF_COUNT; bid++) {
+        recycle_buffer(bid);
+    }
+    return true;
+}
+
+int Uring::enter(unsigned to_submit, unsigned min_complete, unsigned flags, 
+                 const void *arg, size_t arg_size) 
+{
+    int ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+    return ret < 0 ? -errno : ret;
+}
+
+io_uring_sqe* Uring::get_sqe() 
+{
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        submit();
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (sqe_tail - head >= sq_entries) return nullptr;
+    }
+
+    unsigned idx = sqe_tail & *sq_mask;
+    sq_array[idx] = idx;
+    sqe_tail++;
+
+    io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int Uring::submit() 
+{
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned pending = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (pending == 0) return 0;
+    return enter(pending, 0, 0, nullptr, 0);
+}
+
+int Uring::wait(int timeout_ms) 
+{
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned pending = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+
+    if (timeout_ms < 0) {
+        return enter(pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    __kernel_timespec ts{};
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    return enter(pending, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+bool Uring::next_cqe(io_uring_cqe &cqe) 
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    cqe = cqes[head & *cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint8_t* Uring::get_buffer(uint16_t bid) {
+    return buf_pool.data() + static_cast<size_t>(bid) * buf_size;
+}
+
+void Uring::recycle_buffer(uint16_t bid) 
+{
+    // not buf_ring->bufs, __DECLARE_FLEX_ARRAY has a non-zero offset in C++
+    auto bufs = reinterpret_cast<io_uring_buf*>(buf_ring);
+    io_uring_buf &buf = bufs[buf_tail & (URING_BUF_COUNT - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(get_buffer(bid));
+    buf.len = buf_size;
+    buf.bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}